@@ -4,8 +4,20 @@
  */
 
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 #include "crc.h"
 
+/* Use the x86-64 carry-less multiply instruction if compiling with gcc or
+   clang. The code for the instruction is compiled in regardless of the
+   compiler target options, and used only if the processor running the code
+   supports it. */
+#if defined(__GNUC__) && defined(__x86_64__) && WORDBITS == 64
+#  define CLMUL
+#  include <immintrin.h>
+#  include <cpuid.h>
+#endif
+
 word_t crc_bitwise(model_t *model, word_t crc, void const *dat, size_t len)
 {
     unsigned char const *buf = dat;
@@ -109,63 +121,57 @@ word_t crc_zeros(model_t *model, word_t crc, size_t count)
     return crc ^ model->xorout;
 }
 
-void crc_table_bytewise(model_t *model)
+/* Fill in the rest of table[0..255] from the entries for the single bits,
+   table[1], table[2], table[4], ..., table[128], where the entries are linear
+   in k, i.e. table[j ^ k] == table[j] ^ table[k]. This is true of any CRC
+   table with the constant part of its entries removed, since the CRC of a
+   message is linear in the message bits. Then only eight entries need to be
+   computed with the CRC calculation, and the other 248 are an exclusive-or
+   each. The inner loop exclusive-ors a run of earlier entries with the same
+   value, which compilers can vectorize. */
+static void linear_fill(word_t *table)
 {
-    unsigned char k;
-    word_t crc;
+    table[0] = 0;
+    for (unsigned m = 2; m < 256; m <<= 1) {
+        word_t bit = table[m];
+        for (unsigned k = 1; k < m; k++)
+            table[m + k] = bit ^ table[k];
+    }
+}
 
-    k = 0;
-    do {
-        crc = crc_bitwise(model, 0, &k, 1);
+/* Fill in table[0..255] with the byte-wise table entries for model, in the
+   form of crc_table_bytewise(), with the constant part removed. Return that
+   constant part, which is table_byte[0]. */
+static word_t byte_linear(model_t *model, word_t *table)
+{
+    word_t zero = crc_bitwise(model, 0, "", 1);
+    if (model->rev)
+        zero = reverse(zero, model->width);
+    if (model->width < 8 && !model->ref)
+        zero <<= 8 - model->width;
+    for (unsigned j = 0; j < 8; j++) {
+        unsigned char k = 1 << j;
+        word_t crc = crc_bitwise(model, 0, &k, 1);
         if (model->rev)
             crc = reverse(crc, model->width);
         if (model->width < 8 && !model->ref)
             crc <<= 8 - model->width;
-        model->table_byte[k] = crc;
-    } while (++k);
+        table[k] = crc ^ zero;
+    }
+    linear_fill(table);
+    return zero;
 }
 
-word_t crc_bytewise(model_t *model, word_t crc, void const *dat, size_t len)
+int crc_table_bytewise(model_t *model)
 {
-    unsigned char const *buf = dat;
-
-    /* if requested, return the initial CRC */
-    if (buf == NULL)
-        return model->init;
-
-    /* pre-process the CRC */
-    if (model->rev)
-        crc = reverse(crc, model->width);
-
-    /* process the input data a byte at a time */
-    if (model->ref) {
-        crc &= ONES(model->width);
-        while (len--)
-            crc = (crc >> 8) ^ model->table_byte[(crc ^ *buf++) & 0xff];
-    }
-    else if (model->width <= 8) {
-        unsigned shift;
-
-        shift = 8 - model->width;           /* 0..7 */
-        crc <<= shift;
-        while (len--)
-            crc = model->table_byte[crc ^ *buf++];
-        crc >>= shift;
-    }
-    else {
-        unsigned shift;
-
-        shift = model->width - 8;           /* 1..WORDBITS-8 */
-        while (len--)
-            crc = (crc << 8) ^
-                  model->table_byte[((crc >> shift) ^ *buf++) & 0xff];
-        crc &= ONES(model->width);
-    }
-
-    /* post-process and return the CRC */
-    if (model->rev)
-        crc = reverse(crc, model->width);
-    return crc;
+    word_t *table = realloc(model->table_byte, 256 * sizeof(word_t));
+    if (table == NULL)
+        return 2;
+    model->table_byte = table;
+    word_t zero = byte_linear(model, table);
+    for (unsigned k = 0; k < 256; k++)
+        table[k] ^= zero;
+    return 0;
 }
 
 /* Swap the bytes in a word_t.  This can be replaced by a byte-swap builtin, if
@@ -187,255 +193,1817 @@ static inline word_t swap(word_t x)
     return y << (n << 3);
 }
 
-void crc_table_wordwise(model_t *model, unsigned little, unsigned word_bits)
+/* Return the word_t at p, which need not be aligned. Compilers turn this into
+   a single load on processors that permit unaligned loads. */
+static inline word_t load(unsigned char const *p)
 {
-    crc_table_bytewise(model);
-    unsigned opp = little ^ model->ref;
-    unsigned top =
-        model->ref ? 0 :
-                     word_bits - (model->width > 8 ? model->width : 8);
-    word_t xor = model->xorout;
-    if (model->width < 8 && !model->ref)
-        xor <<= 8 - model->width;
-    for (unsigned k = 0; k < 256; k++) {
-        word_t crc = model->table_byte[k];
-        model->table_word[0][k] = opp ? swap(crc << top) : crc << top;
-        for (unsigned n = 1; n < (word_bits >> 3); n++) {
-            crc ^= xor;
-            if (model->ref)
-                crc = (crc >> 8) ^ model->table_byte[crc & 0xff];
-            else if (model->width <= 8)
-                crc = model->table_byte[crc];
-            else
-                crc = (crc << 8) ^
-                      model->table_byte[(crc >> (model->width - 8)) & 0xff];
-            crc ^= xor;
-            model->table_word[n][k] = opp ? swap(crc << top) : crc << top;
-        }
+    word_t word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+/* Store the word_t w at p, which need not be aligned. If nt is true and the
+   processor has them, use a non-temporal store, which writes around the cache,
+   in which case p must be aligned. */
+static inline void store(unsigned char *p, word_t w, int nt)
+{
+#ifdef CLMUL
+    if (nt) {
+        _mm_stream_si64((long long *)(void *)p, (long long)w);
+        return;
     }
+#else
+    (void)nt;
+#endif
+    memcpy(p, &w, sizeof(w));
 }
 
-word_t crc_wordwise(model_t *model, word_t crc, void const *dat, size_t len)
+/* Define the table-driven loops for tables with entries of the unsigned
+   integer type type, with sfx appended to the names of the routines:
+
+   bytes_sfx() runs len bytes at buf through the CRC register crc using the
+   byte-wise table, where crc has already been reversed if model->rev is true.
+
+   step_sfx() returns the word-wise table lookup of the word x, using the
+   tables table[], for the endianess little.  table[0] is used for the last
+   byte of x in memory, and table[WORDCHARS - 1] for the first byte.  On a
+   big-endian machine, the entries are shifted up to the top of the word_t.
+
+   words_sfx() runs count words at dat through the CRC register crc in word
+   form, where dat need not be aligned, model->slices bytes at a time, and
+   then a word at a time.  The bytes in the later words of a slice step are
+   looked up independently of crc, so that their lookups can proceed in
+   parallel with the ones for the first word.
+
+   update_sfx() is crc_ctx_update() for the model's tables in ctx.
+
+   lanes_sfx() runs count words through each of the act CRC registers in word
+   form in crc[], from the data at the corresponding pointers in at[],
+   advancing the pointers. The registers are advanced together a word at a
+   time, so that their lookups, which do not depend on each other, can
+   proceed in parallel.
+
+   copy_sfx() is words_sfx(), but also stores each word at src to dst as it
+   is loaded, using store() with nt.
+
+   wordwise_sfx() is crc_wordwise() for a CRC that has been reversed if
+   model->rev is true, or if dst is not NULL, crc_copy() with nt. The words
+   are aligned in dst if there is one, since the stores may be non-temporal,
+   or else in buf. */
+#define NARROW(sfx, type) \
+    static word_t bytes_##sfx(model_t *model, type const *table, word_t crc, \
+                              unsigned char const *buf, size_t len) \
+    { \
+        if (model->ref) { \
+            crc &= ONES(model->width); \
+            while (len--) \
+                crc = (crc >> 8) ^ table[(crc ^ *buf++) & 0xff]; \
+        } \
+        else if (model->width <= 8) { \
+            unsigned shift = 8 - model->width; \
+            crc <<= shift; \
+            while (len--) \
+                crc = table[crc ^ *buf++]; \
+            crc >>= shift; \
+        } \
+        else { \
+            unsigned shift = model->width - 8; \
+            while (len--) \
+                crc = (crc << 8) ^ table[((crc >> shift) ^ *buf++) & 0xff]; \
+            crc &= ONES(model->width); \
+        } \
+        return crc; \
+    } \
+    static inline word_t step_##sfx(type const (*table)[256], \
+                                    unsigned little, word_t x) \
+    { \
+        unsigned shift = little ? 0 : WORDBITS - 8 * sizeof(type); \
+        word_t crc = 0; \
+        for (unsigned k = 0; k < WORDCHARS; k++) \
+            crc ^= (word_t)table[little ? WORDCHARS - 1 - k : k] \
+                                [(x >> (k << 3)) & 0xff] << shift; \
+        return crc; \
+    } \
+    static word_t words_##sfx(model_t *model, unsigned little, word_t crc, \
+                              void const *dat, size_t count) \
+    { \
+        unsigned char const *word = dat; \
+        type const (*table)[256] = model->table_word; \
+        type const (*first)[256] = table + model->slices - WORDCHARS; \
+        size_t per = model->slices / WORDCHARS; \
+        while (per > 1 && count >= per) { \
+            word_t next = 0; \
+            for (unsigned n = 1; n < per; n++) \
+                next ^= step_##sfx(first - n * WORDCHARS, little, \
+                                   load(word + n * WORDCHARS)); \
+            crc = next ^ step_##sfx(first, little, crc ^ load(word)); \
+            word += per * WORDCHARS; \
+            count -= per; \
+        } \
+        while (count--) { \
+            crc = step_##sfx(table, little, crc ^ load(word)); \
+            word += WORDCHARS; \
+        } \
+        return crc; \
+    } \
+    static word_t copy_##sfx(model_t *model, unsigned little, word_t crc, \
+                             unsigned char *dst, unsigned char const *src, \
+                             size_t count, int nt) \
+    { \
+        type const (*table)[256] = model->table_word; \
+        type const (*first)[256] = table + model->slices - WORDCHARS; \
+        size_t per = model->slices / WORDCHARS; \
+        while (per > 1 && count >= per) { \
+            word_t next = 0; \
+            for (unsigned n = 1; n < per; n++) { \
+                word_t w = load(src + n * WORDCHARS); \
+                store(dst + n * WORDCHARS, w, nt); \
+                next ^= step_##sfx(first - n * WORDCHARS, little, w); \
+            } \
+            word_t w = load(src); \
+            store(dst, w, nt); \
+            crc = next ^ step_##sfx(first, little, crc ^ w); \
+            src += per * WORDCHARS; \
+            dst += per * WORDCHARS; \
+            count -= per; \
+        } \
+        while (count--) { \
+            word_t w = load(src); \
+            store(dst, w, nt); \
+            crc = step_##sfx(table, little, crc ^ w); \
+            src += WORDCHARS; \
+            dst += WORDCHARS; \
+        } \
+        return crc; \
+    } \
+    static void lanes_##sfx(model_t *model, unsigned little, word_t *crc, \
+                            unsigned char const **at, unsigned act, \
+                            size_t count) \
+    { \
+        type const (*table)[256] = model->table_word; \
+        while (count--) \
+            for (unsigned k = 0; k < act; k++) { \
+                crc[k] = step_##sfx(table, little, crc[k] ^ load(at[k])); \
+                at[k] += WORDCHARS; \
+            } \
+    } \
+    static void update_##sfx(crc_ctx_t *ctx, void const *dat, size_t len) \
+    { \
+        unsigned char const *buf = dat; \
+        type const (*table)[256] = ctx->model->table_word; \
+        word_t crc = ctx->crc; \
+        unsigned have = ctx->have; \
+        if (have) { \
+            while (len && have < WORDCHARS) { \
+                ctx->tail[have++] = *buf++; \
+                len--; \
+            } \
+            if (have < WORDCHARS) { \
+                ctx->have = have; \
+                return; \
+            } \
+            crc = step_##sfx(table, ctx->little, crc ^ load(ctx->tail)); \
+        } \
+        size_t n = len / WORDCHARS; \
+        if (n) { \
+            crc = words_##sfx(ctx->model, ctx->little, crc, buf, n); \
+            buf += n * WORDCHARS; \
+            len -= n * WORDCHARS; \
+        } \
+        for (have = 0; have < len; have++) \
+            ctx->tail[have] = buf[have]; \
+        ctx->have = have; \
+        ctx->crc = crc; \
+    } \
+    static word_t wordwise_##sfx(model_t *model, word_t crc, \
+                                 unsigned char *dst, \
+                                 unsigned char const *buf, size_t len, \
+                                 int nt) \
+    { \
+        type const *byte = \
+            ((type const (*)[256])model->table_word)[model->slices]; \
+        unsigned little = model->table_little, top = model->table_top, \
+                 opp = little ^ model->ref; \
+        size_t pre = -(uintptr_t)(dst == NULL ? buf : dst) & \
+                     (WORDCHARS - 1); \
+        if (pre > len) \
+            pre = len; \
+        if (dst != NULL) { \
+            memcpy(dst, buf, pre); \
+            dst += pre; \
+        } \
+        crc = bytes_##sfx(model, byte, crc, buf, pre); \
+        buf += pre; \
+        len -= pre; \
+        if (len >= WORDCHARS) { \
+            if (model->width < 8 && !model->ref) \
+                crc <<= 8 - model->width; \
+            crc <<= top; \
+            if (opp) \
+                crc = swap(crc); \
+            crc = dst == NULL ? \
+                words_##sfx(model, little, crc, buf, len / WORDCHARS) : \
+                copy_##sfx(model, little, crc, dst, buf, len / WORDCHARS, \
+                           nt); \
+            if (opp) \
+                crc = swap(crc); \
+            crc >>= top; \
+            if (model->width < 8 && !model->ref) \
+                crc >>= 8 - model->width; \
+            pre = len & ~(size_t)(WORDCHARS - 1); \
+            buf += pre; \
+            if (dst != NULL) \
+                dst += pre; \
+            len &= WORDCHARS - 1; \
+        } \
+        if (dst != NULL) \
+            memcpy(dst, buf, len); \
+        return bytes_##sfx(model, byte, crc, buf, len); \
+    }
+
+NARROW(8, uint8_t)
+#if WORDCHARS > 2
+NARROW(16, uint16_t)
+#endif
+#if WORDCHARS > 4
+NARROW(32, uint32_t)
+#endif
+NARROW(w, word_t)
+
+word_t crc_bytewise(model_t *model, word_t crc, void const *dat, size_t len)
 {
     unsigned char const *buf = dat;
-    unsigned little, top, shift;
 
     /* if requested, return the initial CRC */
     if (buf == NULL)
         return model->init;
 
-    /* prepare common constants */
-    little = 1;
-    little = *((unsigned char *)(&little));
-    top = model->ref ? 0 : WORDBITS - (model->width > 8 ? model->width : 8);
-    shift = model->width <= 8 ? 8 - model->width : model->width - 8;
+    /* use table_byte, which includes the final exclusive-or, if the narrow
+       tables have not been built */
+    if (model->table_word == NULL) {
+        if (model->rev)
+            crc = reverse(crc, model->width);
+        crc = bytes_w(model, model->table_byte, crc, buf, len);
+        if (model->rev)
+            crc = reverse(crc, model->width);
+        return crc;
+    }
 
     /* pre-process the CRC */
+    crc ^= model->xorout;
     if (model->rev)
         crc = reverse(crc, model->width);
 
-    /* process the first few bytes up to a word_t boundary, if any */
-    if (model->ref) {
-        crc &= ONES(model->width);
-        while (len && ((ptrdiff_t)buf & (WORDCHARS - 1))) {
-            crc = (crc >> 8) ^ model->table_byte[(crc ^ *buf++) & 0xff];
-            len--;
-        }
+    /* process the input data a byte at a time, using the narrow copy of the
+       byte-wise table stored after the word-wise tables */
+    void const *table = (unsigned char const *)model->table_word +
+                        ((size_t)model->slices << 8) * model->table_bytes;
+    switch (model->table_bytes) {
+    case 1:
+        crc = bytes_8(model, table, crc, buf, len);
+        break;
+#if WORDCHARS > 2
+    case 2:
+        crc = bytes_16(model, table, crc, buf, len);
+        break;
+#endif
+#if WORDCHARS > 4
+    case 4:
+        crc = bytes_32(model, table, crc, buf, len);
+        break;
+#endif
+    default:
+        crc = bytes_w(model, table, crc, buf, len);
     }
-    else if (model->width <= 8) {
-        crc <<= shift;
-        while (len && ((ptrdiff_t)buf & (WORDCHARS - 1))) {
-            crc = model->table_byte[(crc ^ *buf++) & 0xff];
-            len--;
-        }
+
+    /* post-process and return the CRC */
+    if (model->rev)
+        crc = reverse(crc, model->width);
+    return crc ^ model->xorout;
+}
+
+/* Return the number of bytes in the narrowest unsigned integer type that can
+   hold a run of n bytes. */
+static unsigned narrow_bytes(unsigned n)
+{
+    return n <= 1 ? 1 : n <= 2 ? 2 : n <= 4 ? 4 : WORDCHARS;
+}
+
+unsigned crc_table_narrow(unsigned width, unsigned ref, unsigned little,
+                          unsigned word_bits, unsigned *shift)
+{
+    /* find the bytes [lo, hi) of a word_t that the entries can occupy, and
+       from that the narrowest type and the shift to store them in */
+    unsigned opp = little ^ ref;
+    unsigned top = ref ? 0 : word_bits - (width > 8 ? width : 8);
+    unsigned lo = top >> 3;
+    unsigned hi = ref ? (width + 7U) >> 3 : word_bits >> 3;
+    if (opp) {
+        unsigned tmp = WORDCHARS - hi;
+        hi = WORDCHARS - lo;
+        lo = tmp;
     }
-    else
-        while (len && ((ptrdiff_t)buf & (WORDCHARS - 1))) {
-            crc = (crc << 8) ^
-                  model->table_byte[((crc >> shift) ^ *buf++) & 0xff];
-            len--;
-        }
+    unsigned bytes = narrow_bytes(hi - lo);
+    if (lo > WORDCHARS - bytes)
+        lo = WORDCHARS - bytes;
+    *shift = lo << 3;
+    return bytes;
+}
 
-    /* process as many word_t's as are available */
-    if (len >= WORDCHARS) {
-        crc <<= top;
-        if (little) {
-            if (!model->ref)
-                crc = swap(crc);
-            do {
-                crc ^= *(word_t const *)buf;
-                crc = model->table_word[WORDCHARS - 1][crc & 0xff]
-                    ^ model->table_word[WORDCHARS - 2][(crc >> 8)
+/* Store the 256 entries src[] as table n of table, which has entries of bytes
+   bytes. */
+static void narrow_store(void *table, unsigned bytes, unsigned n,
+                         word_t const *src)
+{
+    size_t i = (size_t)n << 8;
+    switch (bytes) {
+    case 1:
+        for (unsigned k = 0; k < 256; k++)
+            ((uint8_t *)table)[i + k] = (uint8_t)src[k];
+        break;
 #if WORDCHARS > 2
-                                                                  & 0xff]
-                    ^ model->table_word[WORDCHARS - 3][(crc >> 16) & 0xff]
-                    ^ model->table_word[WORDCHARS - 4][(crc >> 24)
-#if WORDCHARS > 4
-                                                                   & 0xff]
-                    ^ model->table_word[WORDCHARS - 5][(crc >> 32) & 0xff]
-                    ^ model->table_word[WORDCHARS - 6][(crc >> 40) & 0xff]
-                    ^ model->table_word[WORDCHARS - 7][(crc >> 48) & 0xff]
-                    ^ model->table_word[WORDCHARS - 8][(crc >> 56)
-#if WORDCHARS > 8
-                                                                   & 0xff]
-                    ^ model->table_word[WORDCHARS - 9][(crc >> 64) & 0xff]
-                    ^ model->table_word[WORDCHARS - 10][(crc >> 72) & 0xff]
-                    ^ model->table_word[WORDCHARS - 11][(crc >> 80) & 0xff]
-                    ^ model->table_word[WORDCHARS - 12][(crc >> 88) & 0xff]
-                    ^ model->table_word[WORDCHARS - 13][(crc >> 96) & 0xff]
-                    ^ model->table_word[WORDCHARS - 14][(crc >> 104) & 0xff]
-                    ^ model->table_word[WORDCHARS - 15][(crc >> 112) & 0xff]
-                    ^ model->table_word[WORDCHARS - 16][(crc >> 120)
-#endif
-#endif
+    case 2:
+        for (unsigned k = 0; k < 256; k++)
+            ((uint16_t *)table)[i + k] = (uint16_t)src[k];
+        break;
 #endif
-                                                                    ];
-                buf += WORDCHARS;
-                len -= WORDCHARS;
-            } while (len >= WORDCHARS);
-            if (!model->ref)
-                crc = swap(crc);
-        }
-        else {
-            if (model->ref)
-                crc = swap(crc);
-            do {
-                crc ^= *(word_t const *)buf;
-                crc = model->table_word[0][crc & 0xff]
-                    ^ model->table_word[1][(crc >> 8)
-#if WORDCHARS > 2
-                                                      & 0xff]
-                    ^ model->table_word[2][(crc >> 16) & 0xff]
-                    ^ model->table_word[3][(crc >> 24)
 #if WORDCHARS > 4
-                                                       & 0xff]
-                    ^ model->table_word[4][(crc >> 32) & 0xff]
-                    ^ model->table_word[5][(crc >> 40) & 0xff]
-                    ^ model->table_word[6][(crc >> 48) & 0xff]
-                    ^ model->table_word[7][(crc >> 56)
-#if WORDCHARS > 8
-                                                       & 0xff]
-                    ^ model->table_word[8][(crc >> 64) & 0xff]
-                    ^ model->table_word[9][(crc >> 72) & 0xff]
-                    ^ model->table_word[10][(crc >> 80) & 0xff]
-                    ^ model->table_word[11][(crc >> 88) & 0xff]
-                    ^ model->table_word[12][(crc >> 96) & 0xff]
-                    ^ model->table_word[13][(crc >> 104) & 0xff]
-                    ^ model->table_word[14][(crc >> 112) & 0xff]
-                    ^ model->table_word[15][(crc >> 120)
+    case 4:
+        for (unsigned k = 0; k < 256; k++)
+            ((uint32_t *)table)[i + k] = (uint32_t)src[k];
+        break;
 #endif
+    default:
+        for (unsigned k = 0; k < 256; k++)
+            ((word_t *)table)[i + k] = src[k];
+    }
+}
+
+/* Return entry i of table, which has entries of bytes bytes. */
+static word_t narrow_get(void const *table, unsigned bytes, size_t i)
+{
+    switch (bytes) {
+    case 1:
+        return ((uint8_t const *)table)[i];
+#if WORDCHARS > 2
+    case 2:
+        return ((uint16_t const *)table)[i];
 #endif
+#if WORDCHARS > 4
+    case 4:
+        return ((uint32_t const *)table)[i];
 #endif
-                                                        ];
-                buf += WORDCHARS;
-                len -= WORDCHARS;
-            } while (len >= WORDCHARS);
-            if (model->ref)
-                crc = swap(crc);
+    default:
+        return ((word_t const *)table)[i];
+    }
+}
+
+/* A set of narrow tables, along with the parameters that determine their
+   contents. In the registry of shared tables, the sets are linked by next. */
+typedef struct tables_s {
+    struct tables_s *next;      /* next set in the registry */
+    word_t poly;                /* CRC polynomial, reflected if ref */
+    unsigned short width;       /* number of bits in the CRC */
+    unsigned short slices;      /* number of word-wise tables */
+    unsigned char ref;          /* true if the CRC is reflected */
+    unsigned char little;       /* true if built for little-endian */
+    unsigned char bits;         /* word size built for */
+    unsigned char bytes;        /* bytes per entry */
+    unsigned char shift;        /* bits the entries are shifted down */
+    void *table;                /* the allocated tables */
+} tables_t;
+
+/* Return true if the tables in set are the ones for model with the given
+   endianess, word size, and number of slices. */
+static int narrow_match(tables_t const *set, model_t const *model,
+                        unsigned little, unsigned word_bits, unsigned slices)
+{
+    return set->width == model->width && set->poly == model->poly &&
+           set->ref == model->ref && set->little == little &&
+           set->bits == word_bits && set->slices == slices;
+}
+
+/* Allocate and fill in set->table with the narrow tables for model, for the
+   endianess little and the word size word_bits, with slices word-wise tables,
+   and fill in the rest of set. The tables have no initial or final
+   exclusive-or, so that they depend only on the parameters in set. Return 0
+   on success, or 2 if out of memory. */
+static int narrow_build(model_t *model, unsigned little, unsigned word_bits,
+                        unsigned slices, tables_t *set)
+{
+    unsigned opp = little ^ model->ref, shift;
+    unsigned top =
+        model->ref ? 0 :
+                     word_bits - (model->width > 8 ? model->width : 8);
+    unsigned bytes = crc_table_narrow(model->width, model->ref, little,
+                                      word_bits, &shift);
+    void *table = malloc((size_t)(slices + 1) * 256 * bytes);
+    if (table == NULL)
+        return 2;
+    set->table = table;
+    set->poly = model->poly;
+    set->width = model->width;
+    set->slices = slices;
+    set->ref = model->ref;
+    set->little = little;
+    set->bits = word_bits;
+    set->bytes = bytes;
+    set->shift = shift;
+
+    /* byte-wise table with the constant part removed */
+    word_t byte[256];
+    byte_linear(model, byte);
+    narrow_store(table, bytes, slices, byte);
+
+    /* word-wise tables, a table at a time, each from the entries for the
+       single bits of the byte, which are each advanced by a zero byte from
+       those of the previous table */
+    word_t bit[8], word[256];
+    for (unsigned j = 0; j < 8; j++)
+        bit[j] = byte[1 << j];
+    for (unsigned n = 0; n < slices; n++) {
+        for (unsigned j = 0; j < 8; j++) {
+            word_t crc = bit[j];
+            if (n) {
+                if (model->ref)
+                    crc = (crc >> 8) ^ byte[crc & 0xff];
+                else if (model->width <= 8)
+                    crc = byte[crc];
+                else
+                    crc = ((crc << 8) & ONES(model->width)) ^
+                          byte[(crc >> (model->width - 8)) & 0xff];
+                bit[j] = crc;
+            }
+            word[1 << j] =
+                (opp ? swap(crc << top) : crc << top) >> shift;
         }
-        crc >>= top;
+        linear_fill(word);
+        narrow_store(table, bytes, n, word);
     }
+    return 0;
+}
 
-    /* process any remaining bytes after the last word_t */
-    if (model->ref)
-        while (len--)
-            crc = (crc >> 8) ^ model->table_byte[(crc ^ *buf++) & 0xff];
-    else if (model->width <= 8) {
-        while (len--)
-            crc = model->table_byte[(crc ^ *buf++) & 0xff];
-        crc >>= shift;
+/* Use the tables in set for model, freeing the tables it had if they were not
+   shared. */
+static void narrow_use(model_t *model, tables_t const *set, int shared)
+{
+    if (!model->table_shared)
+        free(model->table_word);
+    model->table_word = set->table;
+    model->table_shared = shared;
+    model->slices = set->slices;
+    model->table_bytes = set->bytes;
+    model->table_shift = set->shift;
+    model->table_little = set->little;
+    model->table_bits = set->bits;
+    model->table_top =
+        model->ref ? 0 : set->bits - (model->width > 8 ? model->width : 8);
+}
+
+word_t crc_table_word(model_t *model, unsigned n, unsigned k)
+{
+    /* the stored tables have no initial or final exclusive-or, so compute
+       the constant part of the entry, which is the CRC register for n + 1
+       zero bytes with the final exclusive-or applied after each byte, as
+       crc_bitwise() would do */
+    unsigned bytes = model->table_bytes;
+    void const *byte = (unsigned char const *)model->table_word +
+                       ((size_t)model->slices << 8) * bytes;
+    word_t xor = model->xorout;
+    if (model->rev)
+        xor = reverse(xor, model->width);
+    word_t zero = crc_bitwise(model, 0, "", 1);
+    if (model->rev)
+        zero = reverse(zero, model->width);
+    if (model->width < 8 && !model->ref) {
+        xor <<= 8 - model->width;
+        zero <<= 8 - model->width;
     }
-    else {
-        while (len--)
-            crc = (crc << 8) ^
-                  model->table_byte[((crc >> shift) ^ *buf++) & 0xff];
-        crc &= ONES(model->width);
+    word_t crc = zero;
+    for (unsigned i = 0; i < n; i++) {
+        crc ^= xor;
+        if (model->ref)
+            crc = (crc >> 8) ^ narrow_get(byte, bytes, crc & 0xff);
+        else if (model->width <= 8)
+            crc = narrow_get(byte, bytes, crc);
+        else
+            crc = ((crc << 8) & ONES(model->width)) ^
+                  narrow_get(byte, bytes, (crc >> (model->width - 8)) & 0xff);
+        crc ^= zero ^ xor;
     }
 
-    /* post-process and return the CRC */
-    if (model->rev)
-        crc = reverse(crc, model->width);
-    return crc;
+    /* put that in word form, and add it to the stored entry */
+    crc <<= model->table_top;
+    if (model->table_little ^ model->ref)
+        crc = swap(crc);
+    return crc ^ (narrow_get(model->table_word, bytes,
+                             ((size_t)n << 8) + k) << model->table_shift);
 }
 
-// Return a(x) multiplied by b(x) modulo p(x), where p(x) is the CRC
-// polynomial. For speed, this requires that a not be zero.
-static word_t multmodp(model_t *model, word_t a, word_t b) {
-    word_t top = (word_t)1 << (model->width - 1);
-    word_t prod = 0;
-    if (model->ref) {
-        // reflected polynomial
-        for (;;) {
-            if (a & top) {
-                prod ^= b;
-                if ((a & (top - 1)) == 0)
-                    break;
-            }
-            a <<= 1;
-            b = b & 1 ? (b >> 1) ^ model->poly : b >> 1;
+int crc_table_wordwise(model_t *model, unsigned little, unsigned word_bits,
+                       unsigned slices)
+{
+    if ((word_bits != 32 && word_bits != 64) || slices == 0 || slices > 64 ||
+        slices % (word_bits >> 3))
+        return 1;
+    tables_t set;
+    if (narrow_build(model, little, word_bits, slices, &set))
+        return 2;
+    narrow_use(model, &set, 0);
+    return 0;
+}
+
+/* The registry of shared tables is a singly-linked list that is only ever
+   added to at the head, until crc_shared_free(). A new set is published with
+   a compare-and-swap that releases its contents, and the list is read after
+   an acquiring load, so no lock is needed to look up or add a set. The GNU C
+   atomic builtins are used for that, which are provided by gcc, clang, and
+   icc. Without them, each model gets its own tables. */
+#ifdef __GNUC__
+static tables_t *registry = NULL;
+#endif
+
+int crc_table_shared(model_t *model, unsigned little, unsigned word_bits,
+                     unsigned slices)
+{
+    if ((word_bits != 32 && word_bits != 64) || slices == 0 || slices > 64 ||
+        slices % (word_bits >> 3))
+        return 1;
+#ifdef __GNUC__
+    /* look for the tables in the registry */
+    tables_t *head = __atomic_load_n(&registry, __ATOMIC_ACQUIRE), *set;
+    for (set = head; set != NULL; set = set->next)
+        if (narrow_match(set, model, little, word_bits, slices)) {
+            narrow_use(model, set, 1);
+            return 0;
         }
+
+    /* not there -- build them and add them to the registry, unless another
+       thread added the same tables first, in which case use those */
+    set = malloc(sizeof(tables_t));
+    if (set == NULL)
+        return 2;
+    if (narrow_build(model, little, word_bits, slices, set)) {
+        free(set);
+        return 2;
     }
-    else {
-        // normal polynomial
-        for (;;) {
-            if (a & 1) {
-                prod ^= b;
-                if (a == 1)
-                    break;
+    set->next = head;
+    while (!__atomic_compare_exchange_n(&registry, &set->next, set, 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+        for (tables_t *got = set->next; got != head; got = got->next)
+            if (narrow_match(got, model, little, word_bits, slices)) {
+                free(set->table);
+                free(set);
+                narrow_use(model, got, 1);
+                return 0;
             }
-            a >>= 1;
-            b = b & top ? (b << 1) ^ model->poly : b << 1;
-        }
-        prod &= ((top << 1) - 1);
+        head = set->next;
     }
-    return prod;
+    narrow_use(model, set, 1);
+    return 0;
+#else
+    return crc_table_wordwise(model, little, word_bits, slices);
+#endif
 }
 
-void crc_table_combine(model_t *model) {
-    // Keep squaring x^1 modulo p(x), where p(x) is the CRC polynomial, to get
-    // x^2^n. Start saving values in the table with x^2^3, representing the
-    // action of one zero byte. Go until the sequence cycles, or WORDBITS
-    // entries have been filled in.
-    word_t sq = model->ref ? (word_t)1 << (model->width - 2) : 2;   // x^1
-    sq = multmodp(model, sq, sq);           // x^2^1
-    sq = multmodp(model, sq, sq);           // x^2^2
-    sq = multmodp(model, sq, sq);           // x^2^3
-    word_t x8 = model->table_comb[0] = sq;
-    for (unsigned n = 1; n < WORDBITS; n++) {
-        sq = multmodp(model, sq, sq);       // x^2^(n+3)
-        if (sq == x8) {
-            model->cycle = n;
-            return;
-        }
-        model->table_comb[n] = sq;
+void crc_shared_free(void)
+{
+#ifdef __GNUC__
+    tables_t *set = __atomic_exchange_n(&registry, NULL, __ATOMIC_ACQUIRE);
+    while (set != NULL) {
+        tables_t *next = set->next;
+        free(set->table);
+        free(set);
+        set = next;
     }
-    model->cycle = WORDBITS;
+#endif
 }
 
-// Return x^(8n) modulo p(x), where p(x) is the CRC polynomial. model->cycle
-// and model->table_comb[] must first be initialized by crc_table_combine().
-static word_t x8nmodp(model_t *model, uintmax_t n) {
-    word_t xp = model->ref ? (word_t)1 << (model->width - 1) : 1;   // x^0
-    unsigned k = 0;
-    while (n) {
-        if (n & 1)
-            xp = multmodp(model, model->table_comb[k], xp);
-        n >>= 1;
-        if (++k == model->cycle)
-            k = 0;
+/* Return the word-wise table lookup of the word x in the same way as
+   step_w(), for the braid tables. */
+static inline word_t word_step(word_t table[][256], unsigned little,
+                               word_t x)
+{
+    word_t crc = 0;
+    for (unsigned k = 0; k < WORDCHARS; k++)
+        crc ^= table[little ? WORDCHARS - 1 - k : k][(x >> (k << 3)) & 0xff];
+    return crc;
+}
+
+/* Run count words at word through the CRC register crc in word form, using the
+   word-wise tables of the model. */
+static word_t words(model_t *model, unsigned little, word_t crc,
+                    void const *word, size_t count)
+{
+    switch (model->table_bytes) {
+    case 1:
+        return words_8(model, little, crc, word, count);
+#if WORDCHARS > 2
+    case 2:
+        return words_16(model, little, crc, word, count);
+#endif
+#if WORDCHARS > 4
+    case 4:
+        return words_32(model, little, crc, word, count);
+#endif
+    default:
+        return words_w(model, little, crc, word, count);
     }
-    return xp;
 }
 
-word_t crc_combine(model_t *model, word_t crc1, word_t crc2,
-                   uintmax_t len2) {
-    crc1 ^= model->init;
-    if (model->rev) {
-        crc1 = reverse(crc1, model->width);
-        crc2 = reverse(crc2, model->width);
+/* Return the CRC of buf[0..len-1] continuing from crc, using the word-wise
+   tables, and if dst is not NULL, copy buf[0..len-1] to dst at the same time,
+   using non-temporal stores if nt is true. */
+static word_t wordwise(model_t *model, word_t crc, unsigned char *dst,
+                       unsigned char const *buf, size_t len, int nt)
+{
+    /* pre-process the CRC */
+    crc ^= model->xorout;
+    if (model->rev)
+        crc = reverse(crc, model->width);
+
+    /* process the input data with the tables of the model's entry size */
+    switch (model->table_bytes) {
+    case 1:
+        crc = wordwise_8(model, crc, dst, buf, len, nt);
+        break;
+#if WORDCHARS > 2
+    case 2:
+        crc = wordwise_16(model, crc, dst, buf, len, nt);
+        break;
+#endif
+#if WORDCHARS > 4
+    case 4:
+        crc = wordwise_32(model, crc, dst, buf, len, nt);
+        break;
+#endif
+    default:
+        crc = wordwise_w(model, crc, dst, buf, len, nt);
     }
-    word_t crc = multmodp(model, x8nmodp(model, len2), crc1) ^ crc2;
+
+    /* post-process and return the CRC */
     if (model->rev)
         crc = reverse(crc, model->width);
-    return crc;
+    return crc ^ model->xorout;
+}
+
+word_t crc_wordwise(model_t *model, word_t crc, void const *dat, size_t len)
+{
+    unsigned char const *buf = dat;
+
+    /* if requested, return the initial CRC */
+    if (buf == NULL)
+        return model->init;
+
+    return wordwise(model, crc, NULL, buf, len, 0);
+}
+
+word_t crc_copy(model_t *model, word_t crc, void *dst, void const *src,
+                size_t len)
+{
+    /* if requested, return the initial CRC */
+    if (src == NULL)
+        return model->init;
+
+    /* copy and compute, using non-temporal stores for long copies if the
+       processor has them, which must be fenced before returning so that the
+       data is visible to other threads */
+#ifdef CLMUL
+    if (len >= COPY_NT) {
+        crc = wordwise(model, crc, dst, src, len, 1);
+        _mm_sfence();
+        return crc;
+    }
+#endif
+    return wordwise(model, crc, dst, src, len, 0);
+}
+
+/* Return crc in the form used by the word-wise tables for the endianess
+   little, as a CRC register to exclusive-or words of data into. */
+static word_t word_form(model_t *model, unsigned little, word_t crc)
+{
+    crc ^= model->xorout;
+    if (model->rev)
+        crc = reverse(crc, model->width);
+    if (model->width < 8 && !model->ref)
+        crc <<= 8 - model->width;
+    crc <<= model->table_top;
+    return little ^ model->ref ? swap(crc) : crc;
+}
+
+/* Return the CRC register crc from word_form() to the usual form of a CRC. */
+static word_t usual_form(model_t *model, unsigned little, word_t crc)
+{
+    if (little ^ model->ref)
+        crc = swap(crc);
+    crc >>= model->table_top;
+    if (model->width < 8 && !model->ref)
+        crc >>= 8 - model->width;
+    if (model->rev)
+        crc = reverse(crc, model->width);
+    return crc ^ model->xorout;
+}
+
+void crc_ctx_init(crc_ctx_t *ctx, model_t *model, word_t crc)
+{
+    ctx->model = model;
+    ctx->little = 1;
+    ctx->little = *((unsigned char *)(&ctx->little));
+    ctx->have = 0;
+    switch (model->table_bytes) {
+    case 1:
+        ctx->update = update_8;
+        break;
+#if WORDCHARS > 2
+    case 2:
+        ctx->update = update_16;
+        break;
+#endif
+#if WORDCHARS > 4
+    case 4:
+        ctx->update = update_32;
+        break;
+#endif
+    default:
+        ctx->update = update_w;
+    }
+
+    ctx->crc = word_form(model, ctx->little, crc);
+}
+
+void crc_ctx_update(crc_ctx_t *ctx, void const *buf, size_t len)
+{
+    ctx->update(ctx, buf, len);
+}
+
+word_t crc_ctx_final(crc_ctx_t const *ctx)
+{
+    /* return the CRC to its usual form, and run the bytes in tail[] */
+    model_t *model = ctx->model;
+    return crc_bytewise(model, usual_form(model, ctx->little, ctx->crc),
+                        ctx->tail, ctx->have);
+}
+
+void crc_batch(model_t *model, void const *const bufs[],
+               size_t const lens[], word_t crcs[], size_t n)
+{
+    void (*lanes)(model_t *, unsigned, word_t *, unsigned char const **,
+                  unsigned, size_t);
+    switch (model->table_bytes) {
+    case 1:
+        lanes = lanes_8;
+        break;
+#if WORDCHARS > 2
+    case 2:
+        lanes = lanes_16;
+        break;
+#endif
+#if WORDCHARS > 4
+    case 4:
+        lanes = lanes_32;
+        break;
+#endif
+    default:
+        lanes = lanes_w;
+    }
+    unsigned little = 1;
+    little = *((unsigned char *)(&little));
+
+    /* each lane has a message in progress, with its CRC register in word
+       form, the next word, the number of words left, and the message index */
+    word_t crc[BATCH];
+    unsigned char const *at[BATCH];
+    size_t left[BATCH], which[BATCH];
+    unsigned act = 0;
+    size_t next = 0;
+    for (;;) {
+        /* fill the empty lanes with the next messages, doing the ones with
+           less than a word right away */
+        while (act < BATCH && next < n) {
+            if (lens[next] < WORDCHARS) {
+                crcs[next] = crc_bytewise(model, crcs[next], bufs[next],
+                                          lens[next]);
+                next++;
+                continue;
+            }
+            crc[act] = word_form(model, little, crcs[next]);
+            at[act] = bufs[next];
+            left[act] = lens[next] / WORDCHARS;
+            which[act++] = next++;
+        }
+        if (act == 0)
+            break;
+
+        /* advance all of the lanes until the shortest one runs out */
+        size_t count = left[0];
+        for (unsigned k = 1; k < act; k++)
+            if (left[k] < count)
+                count = left[k];
+        lanes(model, little, crc, at, act, count);
+
+        /* finish the messages that ran out, and move the last lane into
+           each one's place */
+        for (unsigned k = 0; k < act;) {
+            left[k] -= count;
+            if (left[k]) {
+                k++;
+                continue;
+            }
+            size_t i = which[k];
+            crcs[i] = crc_bytewise(model, usual_form(model, little, crc[k]),
+                                   at[k], lens[i] & (WORDCHARS - 1));
+            act--;
+            crc[k] = crc[act];
+            at[k] = at[act];
+            left[k] = left[act];
+            which[k] = which[act];
+        }
+    }
+}
+
+/* Run one zero byte through the CRC register crc, using model->table_byte[]
+   with the constant part of its entries removed. This advances a pure CRC
+   register, i.e. one with no initial or final exclusive-or, in the same form
+   as the table_byte[] entries. */
+static inline word_t zero_byte(model_t *model, word_t crc)
+{
+    word_t zero = model->table_byte[0];
+    if (model->ref)
+        return (crc >> 8) ^ model->table_byte[crc & 0xff] ^ zero;
+    if (model->width <= 8)
+        return model->table_byte[crc] ^ zero;
+    return ((crc << 8) ^
+            model->table_byte[(crc >> (model->width - 8)) & 0xff] ^ zero) &
+           ONES(model->width);
+}
+
+int crc_table_braid(model_t *model, unsigned little)
+{
+    if (crc_table_bytewise(model))
+        return 2;
+    word_t (*table)[256] = realloc(model->table_braid,
+                                   WORDCHARS * sizeof(*table));
+    if (table == NULL)
+        return 2;
+    model->table_braid = table;
+    unsigned opp = little ^ model->ref;
+    unsigned top =
+        model->ref ? 0 : WORDBITS - (model->width > 8 ? model->width : 8);
+    for (unsigned j = 0; j < 8; j++) {
+        unsigned k = 1 << j;
+        word_t crc = model->table_byte[k] ^ model->table_byte[0];
+        for (unsigned n = 0; n < (BRAIDS - 1) * WORDCHARS; n++)
+            crc = zero_byte(model, crc);
+        for (unsigned n = 0; n < WORDCHARS; n++) {
+            if (n)
+                crc = zero_byte(model, crc);
+            table[n][k] = opp ? swap(crc << top) : crc << top;
+        }
+    }
+    for (unsigned n = 0; n < WORDCHARS; n++)
+        linear_fill(table[n]);
+    return 0;
+}
+
+word_t crc_braid(model_t *model, word_t crc, void const *dat, size_t len)
+{
+    unsigned char const *buf = dat;
+    unsigned little, top, opp;
+
+    /* if requested, return the initial CRC */
+    if (buf == NULL)
+        return model->init;
+
+    /* use the word-wise calculation if there are too few blocks to braid */
+    if (len < 2 * BRAIDS * WORDCHARS + WORDCHARS - 1)
+        return crc_wordwise(model, crc, buf, len);
+
+    /* prepare common constants */
+    little = model->table_little;
+    top = model->table_top;
+    opp = little ^ model->ref;
+
+    /* process the first few bytes up to a word_t boundary, if any */
+    size_t pre = -(uintptr_t)buf & (WORDCHARS - 1);
+    crc = crc_wordwise(model, crc, buf, pre);
+    buf += pre;
+    len -= pre;
+
+    /* put the CRC in the same form as the pure word-wise CRC register */
+    crc ^= model->xorout;
+    if (model->rev)
+        crc = reverse(crc, model->width);
+    if (model->width < 8 && !model->ref)
+        crc <<= 8 - model->width;
+    crc <<= top;
+    if (opp)
+        crc = swap(crc);
+
+    /* run BRAIDS independent pure CRCs on interleaved words, with the first
+       one starting with the CRC so far, leaving out the last block */
+    unsigned char const *word = buf;
+    size_t blocks = len / (BRAIDS * WORDCHARS) - 1;
+    word_t lane[BRAIDS];
+    lane[0] = crc;
+    for (unsigned n = 1; n < BRAIDS; n++)
+        lane[n] = 0;
+    while (blocks--) {
+        for (unsigned n = 0; n < BRAIDS; n++)
+            lane[n] = word_step(model->table_braid, little,
+                                lane[n] ^ load(word + n * WORDCHARS));
+        word += BRAIDS * WORDCHARS;
+    }
+
+    /* merge the lanes into one CRC while processing the last block */
+    for (unsigned n = 0; n < BRAIDS; n++)
+        lane[n] ^= load(word + n * WORDCHARS);
+    crc = words(model, little, 0, lane, BRAIDS);
+    word += BRAIDS * WORDCHARS;
+    len -= word - buf;
+    buf = word;
+
+    /* return the CRC to its original form */
+    if (opp)
+        crc = swap(crc);
+    crc >>= top;
+    if (model->width < 8 && !model->ref)
+        crc >>= 8 - model->width;
+    if (model->rev)
+        crc = reverse(crc, model->width);
+    crc ^= model->xorout;
+
+    /* process the remaining words and bytes */
+    return crc_wordwise(model, crc, buf, len);
+}
+
+// Return a(x) multiplied by b(x) modulo p(x), where p(x) is the CRC
+// polynomial. For speed, this requires that a not be zero.
+static word_t multmodp(model_t *model, word_t a, word_t b) {
+    word_t top = (word_t)1 << (model->width - 1);
+    word_t prod = 0;
+    if (model->ref) {
+        // reflected polynomial
+        for (;;) {
+            if (a & top) {
+                prod ^= b;
+                if ((a & (top - 1)) == 0)
+                    break;
+            }
+            a <<= 1;
+            b = b & 1 ? (b >> 1) ^ model->poly : b >> 1;
+        }
+    }
+    else {
+        // normal polynomial
+        for (;;) {
+            if (a & 1) {
+                prod ^= b;
+                if (a == 1)
+                    break;
+            }
+            a >>= 1;
+            b = b & top ? (b << 1) ^ model->poly : b << 1;
+        }
+        prod &= ((top << 1) - 1);
+    }
+    return prod;
+}
+
+// Return a(x) multiplied by b(x) modulo p(x), like multmodp(), but a byte of
+// a at a time, using model->table_byte[] with its constant part removed to
+// multiply the product by x^8 modulo p(x), and tables of b(x) multiplied by
+// all polynomials of degree less than four, for each half of a byte of a. The
+// tables are small enough to build on each call. CRCs shorter than eight bits
+// use multmodp(). a may be zero.
+static word_t multmodp_table(model_t *model, word_t a, word_t b) {
+    unsigned w = model->width;
+    if (w < 8)
+        return a ? multmodp(model, a, b) : 0;
+
+    // Compute b(x) x^k modulo p(x) for k = 0..7, saving each in the entry of
+    // b0[] (k < 4) or b4[] (k >= 4) for the bit of a nibble that represents
+    // x^k or x^(k-4), and then fill in the sums of those for the other
+    // entries.
+    word_t b0[16], b4[16], top = (word_t)1 << (w - 1);
+    for (unsigned k = 0; k < 8; k++) {
+        unsigned bit = model->ref ? 8 >> (k & 3) : 1 << (k & 3);
+        (k < 4 ? b0 : b4)[bit] = b;
+        if (model->ref)
+            b = b & 1 ? (b >> 1) ^ model->poly : b >> 1;
+        else
+            b = b & top ? ((b << 1) ^ model->poly) & ((top << 1) - 1) :
+                          b << 1;
+    }
+    b0[0] = b4[0] = 0;
+    for (unsigned n = 3; n < 16; n++)
+        if (n & (n - 1)) {
+            b0[n] = b0[n & (n - 1)] ^ b0[n & -n];
+            b4[n] = b4[n & (n - 1)] ^ b4[n & -n];
+        }
+
+    // Horner's method over the bytes of a, from the highest powers of x to
+    // the lowest. If w is not a multiple of eight, the highest powers are a
+    // partial byte, which is processed first.
+    word_t const *table = model->table_byte, zero = table[0];
+    word_t prod = 0;
+    unsigned r = w & 7, n = w >> 3, c;
+    if (model->ref) {
+        if (r) {
+            c = (a & ((1 << r) - 1)) << (8 - r);
+            prod = b4[c & 15] ^ b0[c >> 4];
+            a >>= r;
+        }
+        while (n--) {
+            c = a & 0xff;
+            a >>= 8;
+            prod = (prod >> 8) ^ table[prod & 0xff] ^ zero ^
+                   b4[c & 15] ^ b0[c >> 4];
+        }
+    }
+    else {
+        if (r) {
+            c = a >> (n << 3);
+            prod = b0[c & 15] ^ b4[c >> 4];
+        }
+        while (n--) {
+            c = (a >> (n << 3)) & 0xff;
+            prod = ((prod << 8) & ((top << 1) - 1)) ^ table[prod >> (w - 8)] ^
+                   zero ^ b0[c & 15] ^ b4[c >> 4];
+        }
+    }
+    return prod;
+}
+
+// Return a(x) multiplied by b(x) modulo p(x), using carry-less multiply if
+// available, or multmodp_table() otherwise. This requires that the tables
+// have been built by crc_table_combine(). a may be zero.
+static word_t multmodp_fast(model_t *, word_t, word_t);
+
+// Set model->table_clmul[5] and [6] to the Barrett reduction constants for
+// carry-less multiplication modulo p(x) x^(64-w): the low 64 bits of
+// floor(x^128 / q(x)) and of q(x), where q(x) is the scaled polynomial.
+static void barrett(model_t *model) {
+    // The quotient is computed by long division, the top bit of the quotient
+    // (for x^64) being implied.
+    word_t *k = model->table_clmul;
+    unsigned up = 64 - model->width;
+    word_t poly = model->ref ? reverse(model->poly, model->width) :
+                               model->poly;
+    poly <<= up;
+    word_t rem = 1, mu = 0;                 // x^0 after the x^128 bit
+    for (int n = 127; n >= 0; n--) {
+        word_t top = rem >> 63;
+        rem = top ? (rem << 1) ^ poly : rem << 1;
+        if (n < 64)
+            mu |= top << n;
+    }
+    k[5] = model->ref ? reverse(mu, 64) : mu;
+    k[6] = model->ref ? model->poly : poly;
+}
+
+// Fill in the tables used by multmodp_fast() and x8nmodp(), after the cycle
+// and table_comb[] have been determined. Return 0 on success, or 2 if out of
+// memory.
+static int table_powers(model_t *model) {
+    // Tables for multmodp_fast().
+    barrett(model);
+    word_t (*pow)[16] = realloc(model->table_pow,
+                                WORDBITS / 4 * sizeof(*pow));
+    if (pow == NULL)
+        return 2;
+    model->table_pow = pow;
+
+    // table_pow[i][k] is x^(8 k 16^i) modulo p(x), using the cycle of the
+    // powers in table_comb[] to get x^(8 16^i).
+    word_t one = model->ref ? (word_t)1 << (model->width - 1) : 1;  // x^0
+    for (unsigned i = 0; i < WORDBITS / 4; i++) {
+        word_t xp = model->table_comb[(i << 2) % model->cycle];
+        model->table_pow[i][0] = one;
+        model->table_pow[i][1] = xp;
+        for (unsigned k = 2; k < 16; k++)
+            model->table_pow[i][k] =
+                multmodp_table(model, xp, model->table_pow[i][k - 1]);
+    }
+    return 0;
+}
+
+int crc_table_combine(model_t *model) {
+    word_t *comb = realloc(model->table_comb, WORDBITS * sizeof(word_t));
+    if (comb == NULL)
+        return 2;
+    model->table_comb = comb;
+
+    // The byte-wise table speeds up the multiplications here, in
+    // multmodp_table(), as well as those in multmodp_fast().
+    if (crc_table_bytewise(model))
+        return 2;
+
+    // Keep squaring x^1 modulo p(x), where p(x) is the CRC polynomial, to get
+    // x^2^n. Start saving values in the table with x^2^3, representing the
+    // action of one zero byte. Go until the sequence cycles, or WORDBITS
+    // entries have been filled in.
+    word_t sq = model->ref ? (word_t)1 << (model->width - 2) : 2;   // x^1
+    sq = multmodp_table(model, sq, sq);     // x^2^1
+    sq = multmodp_table(model, sq, sq);     // x^2^2
+    sq = multmodp_table(model, sq, sq);     // x^2^3
+    word_t x8 = model->table_comb[0] = sq;
+    for (unsigned n = 1; n < WORDBITS; n++) {
+        sq = multmodp_table(model, sq, sq); // x^2^(n+3)
+        if (sq == x8) {
+            model->cycle = n;
+            return table_powers(model);
+        }
+        model->table_comb[n] = sq;
+    }
+    model->cycle = WORDBITS;
+    return table_powers(model);
+}
+
+// Return x^(8n) modulo p(x), where p(x) is the CRC polynomial. The tables
+// must first be initialized by crc_table_combine(). If the powers cycle, then
+// x^(8 (2^cycle - 1)) is one, so n is reduced modulo 2^cycle - 1. Then there
+// is at most one multiplication for each non-zero hexadecimal digit of n.
+static word_t x8nmodp(model_t *model, uintmax_t n) {
+    if (model->cycle < WORDBITS)
+        n %= ((uintmax_t)1 << model->cycle) - 1;
+    unsigned i = 0;
+    while (n && (n & 15) == 0) {
+        n >>= 4;
+        i++;
+    }
+    word_t xp = model->table_pow[i][n & 15];
+    while (n >>= 4) {
+        i++;
+        if (n & 15)
+            xp = multmodp_fast(model, model->table_pow[i][n & 15], xp);
+    }
+    return xp;
+}
+
+word_t crc_combine(model_t *model, word_t crc1, word_t crc2,
+                   uintmax_t len2) {
+    crc1 ^= model->init;
+    if (model->rev) {
+        crc1 = reverse(crc1, model->width);
+        crc2 = reverse(crc2, model->width);
+    }
+    word_t crc = multmodp_fast(model, x8nmodp(model, len2), crc1) ^ crc2;
+    if (model->rev)
+        crc = reverse(crc, model->width);
+    return crc;
+}
+
+word_t crc_zeros_fast(model_t *model, word_t crc, uintmax_t count)
+{
+    /* pre-process the CRC */
+    crc ^= model->xorout;
+    if (model->rev)
+        crc = reverse(crc, model->width);
+    crc &= ONES(model->width);
+
+    /* multiply by x^count modulo p(x), using the tables for the whole bytes,
+       and then processing the remaining bits one at a time */
+    if (count >> 3)
+        crc = multmodp_fast(model, x8nmodp(model, count >> 3), crc);
+    count &= 7;
+    if (model->ref)
+        while (count--)
+            crc = crc & 1 ? (crc >> 1) ^ model->poly : crc >> 1;
+    else {
+        word_t mask = (word_t)1 << (model->width - 1);
+        while (count--)
+            crc = crc & mask ? (crc << 1) ^ model->poly : crc << 1;
+        crc &= ONES(model->width);
+    }
+
+    /* post-process and return the CRC */
+    if (model->rev)
+        crc = reverse(crc, model->width);
+    return crc ^ model->xorout;
+}
+
+// Return x^n modulo p(x), where p(x) is the CRC polynomial, by repeated
+// squaring, as is done for the powers in crc_table_combine().
+static word_t xnmodp(model_t *model, uintmax_t n) {
+    word_t xp = model->ref ? (word_t)1 << (model->width - 1) : 1;   // x^0
+    word_t sq = model->ref ? (word_t)1 << (model->width - 2) : 2;   // x^1
+    if (model->width == 1)
+        sq = xp;                            // x^1 mod x+1 = x^0
+    while (n) {
+        if (n & 1)
+            xp = multmodp(model, sq, xp);
+        n >>= 1;
+        if (n)
+            sq = multmodp(model, sq, sq);
+    }
+    return xp;
+}
+
+// The carry-less multiply calculation treats every CRC as a 64-bit CRC with
+// the polynomial p(x) x^(64-w), where w is model->width. The CRC register is
+// then that 64-bit CRC shifted down by 64-w bits if not reflected, or is the
+// low w bits of that CRC if reflected. Return x^n modulo p(x) x^(64-w) in the
+// representation used by the folding code, where n must be at least 64. That
+// is x^(64-w) (x^(n-64+w) modulo p(x)), which has the same bits as x^(n-64+w)
+// modulo p(x) in the reflected representation.
+static word_t xnmodp64(model_t *model, uintmax_t n) {
+    unsigned up = 64 - model->width;
+    word_t xp = xnmodp(model, n - up);
+    return model->ref ? xp : xp << up;
+}
+
+void crc_table_clmul(model_t *model) {
+    // The powers of x used to fold the data forward by 512 and 128 bits, to
+    // multiply the final 128 bits by x^64, and to fold forward by 2048 bits.
+    // The two 64-bit halves of the 128-bit data are multiplied by their own
+    // powers. For a reflected CRC, the carry-less product of two reflected
+    // values is the reflection of the product multiplied by x, so the powers
+    // are one less to compensate.
+    word_t *k = model->table_clmul;
+    if (model->ref) {
+        k[0] = xnmodp64(model, 512 + 63);   // low half is high powers
+        k[1] = xnmodp64(model, 512 - 1);
+        k[2] = xnmodp64(model, 128 + 63);
+        k[3] = xnmodp64(model, 128 - 1);
+        k[4] = xnmodp64(model, 128 - 1);
+        k[7] = xnmodp64(model, 2048 + 63);
+        k[8] = xnmodp64(model, 2048 - 1);
+    }
+    else {
+        k[0] = xnmodp64(model, 512);        // low half is low powers
+        k[1] = xnmodp64(model, 512 + 64);
+        k[2] = xnmodp64(model, 128);
+        k[3] = xnmodp64(model, 128 + 64);
+        k[4] = xnmodp64(model, 128);
+        k[7] = xnmodp64(model, 2048);
+        k[8] = xnmodp64(model, 2048 + 64);
+    }
+
+    // The Barrett reduction constants.
+    barrett(model);
+}
+
+#ifdef CLMUL
+
+// Compile the carry-less multiply code for processors that have it.
+#define PCLMUL __attribute__((target("pclmul,ssse3")))
+
+// Return true if the processor supports the pclmulqdq and pshufb
+// instructions. The check is done once. The result is kept with atomic loads
+// and stores, since this can be called from several threads at once. Threads
+// that race to do the check all store the same result.
+static int have_pclmul(void) {
+    static int have = -1;
+    int got = __atomic_load_n(&have, __ATOMIC_RELAXED);
+    if (got == -1) {
+        unsigned a, b, c, d;
+        got = __get_cpuid(1, &a, &b, &c, &d) &&
+              (c & bit_PCLMUL) && (c & bit_SSSE3);
+        __atomic_store_n(&have, got, __ATOMIC_RELAXED);
+    }
+    return got;
+}
+
+// Return the carry-less product of a and b, each a 64-bit polynomial.
+PCLMUL static inline __m128i clmul(word_t a, word_t b) {
+    return _mm_clmulepi64_si128(_mm_cvtsi64_si128(a), _mm_cvtsi64_si128(b), 0);
+}
+
+// Return the low or high 64 bits of x.
+PCLMUL static inline word_t low64(__m128i x) {
+    return _mm_cvtsi128_si64(x);
+}
+PCLMUL static inline word_t high64(__m128i x) {
+    return _mm_cvtsi128_si64(_mm_unpackhi_epi64(x, x));
+}
+
+// Fold x forward by the distance of the powers in k, multiplying each half of
+// x by its power in k.
+PCLMUL static inline __m128i fold(__m128i x, __m128i k) {
+    return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00),
+                         _mm_clmulepi64_si128(x, k, 0x11));
+}
+
+// Load 16 bytes of data. A reflected CRC takes the bytes as a little-endian
+// integer. Otherwise the bytes are reversed, so that the first byte is the
+// highest powers of x.
+#define LOAD(p) (model->ref ? \
+    _mm_loadu_si128((__m128i const *)(p)) : \
+    _mm_shuffle_epi8(_mm_loadu_si128((__m128i const *)(p)), swap))
+
+// Fold the remaining len bytes at buf into x, 128 bits at a time, where len
+// is a multiple of 16. Then reduce x to the CRC register. The CRC is the 128
+// bits in x times x^64, modulo q(x). Multiply the high 64 bits by x^128
+// modulo q(x) and add the low 64 bits times x^64 to get t(x), then use a
+// Barrett reduction to get t(x) modulo q(x). The reflected case uses the same
+// calculation, mirrored.
+PCLMUL static word_t fold_last(model_t *model, __m128i x,
+                               unsigned char const *buf, size_t len) {
+    word_t const *k = model->table_clmul;
+    __m128i swap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+                                8, 9, 10, 11, 12, 13, 14, 15);
+    __m128i k128 = _mm_set_epi64x(k[3], k[2]);
+    while (len) {
+        x = _mm_xor_si128(fold(x, k128), LOAD(buf));
+        buf += 16;
+        len -= 16;
+    }
+    if (model->ref) {
+        __m128i t = clmul(low64(x), k[4]);
+        word_t hi = low64(t) ^ high64(x);
+        word_t q = hi ^ (low64(clmul(hi, k[5])) << 1);
+        __m128i r = clmul(q, k[6]);
+        return high64(t) ^ (high64(r) << 1) ^ (low64(r) >> 63);
+    }
+    else {
+        __m128i t = clmul(high64(x), k[4]);
+        word_t hi = high64(t) ^ low64(x);
+        word_t q = hi ^ high64(clmul(hi, k[5]));
+        return (low64(t) ^ low64(clmul(q, k[6]))) >> (64 - model->width);
+    }
+}
+
+// Process len bytes at buf into the CRC register crc, using carry-less
+// multiplication, where len is a multiple of 16 and at least 64. crc is the
+// CRC register as in crc_bitwise(), without the exclusive-or and reversal.
+PCLMUL static word_t crc_fold(model_t *model, word_t crc,
+                              unsigned char const *buf, size_t len) {
+    word_t const *k = model->table_clmul;
+    unsigned up = 64 - model->width;
+    __m128i swap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+                                8, 9, 10, 11, 12, 13, 14, 15);
+
+    // Bring in the first 64 bytes, with the CRC exclusive-ored into the first
+    // w bits of the message.
+    __m128i x0 = LOAD(buf), x1 = LOAD(buf + 16),
+            x2 = LOAD(buf + 32), x3 = LOAD(buf + 48);
+    x0 = _mm_xor_si128(x0, model->ref ? _mm_set_epi64x(0, crc) :
+                                        _mm_set_epi64x(crc << up, 0));
+    buf += 64;
+    len -= 64;
+
+    // Fold four 128-bit lanes forward 512 bits at a time.
+    __m128i k512 = _mm_set_epi64x(k[1], k[0]);
+    while (len >= 64) {
+        x0 = _mm_xor_si128(fold(x0, k512), LOAD(buf));
+        x1 = _mm_xor_si128(fold(x1, k512), LOAD(buf + 16));
+        x2 = _mm_xor_si128(fold(x2, k512), LOAD(buf + 32));
+        x3 = _mm_xor_si128(fold(x3, k512), LOAD(buf + 48));
+        buf += 64;
+        len -= 64;
+    }
+
+    // Fold the four lanes into one.
+    __m128i k128 = _mm_set_epi64x(k[3], k[2]);
+    x0 = _mm_xor_si128(fold(x0, k128), x1);
+    x0 = _mm_xor_si128(fold(x0, k128), x2);
+    x0 = _mm_xor_si128(fold(x0, k128), x3);
+    return fold_last(model, x0, buf, len);
+}
+
+// Compile the wide-vector carry-less multiply code for processors that have
+// it.
+#define VPCLMUL \
+    __attribute__((target("avx512f,avx512bw,vpclmulqdq,pclmul,ssse3")))
+
+// Return true if the processor supports 512-bit carry-less multiply and byte
+// shuffles, and the operating system saves the 512-bit registers. The check
+// is done once, kept as for have_pclmul().
+static int have_vpclmul(void) {
+    static int have = -1;
+    int got = __atomic_load_n(&have, __ATOMIC_RELAXED);
+    if (got == -1) {
+        unsigned a, b, c, d, lo, hi;
+        got = 0;
+        if (__get_cpuid(1, &a, &b, &c, &d) && (c & bit_OSXSAVE) &&
+            __get_cpuid_count(7, 0, &a, &b, &c, &d) &&
+            (b & bit_AVX512F) && (b & bit_AVX512BW) &&
+            (c & bit_VPCLMULQDQ)) {
+            __asm__ ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+            got = (lo & 0xe6) == 0xe6 && have_pclmul();
+        }
+        __atomic_store_n(&have, got, __ATOMIC_RELAXED);
+    }
+    return got;
+}
+
+// Fold z forward by the distance of the powers in k, in each 128-bit lane.
+VPCLMUL static inline __m512i fold512(__m512i z, __m512i k, __m512i d) {
+    return _mm512_ternarylogic_epi64(_mm512_clmulepi64_epi128(z, k, 0x00),
+                                     _mm512_clmulepi64_epi128(z, k, 0x11),
+                                     d, 0x96);
+}
+
+// Load 64 bytes of data, as for LOAD().
+#define LOAD512(p) (model->ref ? \
+    _mm512_loadu_si512((void const *)(p)) : \
+    _mm512_shuffle_epi8(_mm512_loadu_si512((void const *)(p)), swap512))
+
+// Process len bytes at buf into the CRC register crc, as for crc_fold(), but
+// using 512-bit vectors, each holding four 128-bit lanes. len is a multiple of
+// 16 and at least 256.
+VPCLMUL static word_t crc_fold512(model_t *model, word_t crc,
+                                  unsigned char const *buf, size_t len) {
+    word_t const *k = model->table_clmul;
+    unsigned up = 64 - model->width;
+    __m128i swap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+                                8, 9, 10, 11, 12, 13, 14, 15);
+    __m512i swap512 = _mm512_broadcast_i32x4(swap);
+
+    // Bring in the first 256 bytes, with the CRC exclusive-ored into the first
+    // w bits of the message.
+    __m512i z0 = LOAD512(buf), z1 = LOAD512(buf + 64),
+            z2 = LOAD512(buf + 128), z3 = LOAD512(buf + 192);
+    z0 = _mm512_xor_si512(z0, _mm512_inserti32x4(_mm512_setzero_si512(),
+                model->ref ? _mm_set_epi64x(0, crc) :
+                             _mm_set_epi64x(crc << up, 0), 0));
+    buf += 256;
+    len -= 256;
+
+    // Fold sixteen 128-bit lanes forward 2048 bits at a time.
+    __m512i k2048 = _mm512_broadcast_i32x4(_mm_set_epi64x(k[8], k[7]));
+    while (len >= 256) {
+        z0 = fold512(z0, k2048, LOAD512(buf));
+        z1 = fold512(z1, k2048, LOAD512(buf + 64));
+        z2 = fold512(z2, k2048, LOAD512(buf + 128));
+        z3 = fold512(z3, k2048, LOAD512(buf + 192));
+        buf += 256;
+        len -= 256;
+    }
+
+    // Fold the four vectors into one, and then fold in what's left 512 bits
+    // at a time.
+    __m512i k512 = _mm512_broadcast_i32x4(_mm_set_epi64x(k[1], k[0]));
+    z0 = fold512(z0, k512, z1);
+    z0 = fold512(z0, k512, z2);
+    z0 = fold512(z0, k512, z3);
+    while (len >= 64) {
+        z0 = fold512(z0, k512, LOAD512(buf));
+        buf += 64;
+        len -= 64;
+    }
+
+    // Fold the four lanes into one.
+    __m128i k128 = _mm_set_epi64x(k[3], k[2]);
+    __m128i x = _mm512_extracti32x4_epi32(z0, 0);
+    x = _mm_xor_si128(fold(x, k128), _mm512_extracti32x4_epi32(z0, 1));
+    x = _mm_xor_si128(fold(x, k128), _mm512_extracti32x4_epi32(z0, 2));
+    x = _mm_xor_si128(fold(x, k128), _mm512_extracti32x4_epi32(z0, 3));
+
+    // Clear the upper halves of the vector registers before going to the
+    // non-VEX instructions in fold_last(), which would otherwise incur a
+    // large transition penalty on every call.
+    _mm256_zeroupper();
+    return fold_last(model, x, buf, len);
+}
+
+// Return a(x) multiplied by b(x) modulo p(x), using a carry-less multiply
+// and a Barrett reduction modulo the scaled polynomial p(x) x^(64-w). One of
+// the factors is shifted so that the product is x^(64-w) a(x) b(x), whose
+// remainder has the bits of a(x) b(x) modulo p(x) in the CRC register form.
+PCLMUL static word_t multmodp_clmul(model_t *model, word_t a, word_t b) {
+    word_t const *k = model->table_clmul;
+    unsigned up = 64 - model->width;
+    if (model->ref) {
+        // The reflected product is multiplied by x, so shift it back.
+        __m128i t = clmul(a << up, b);
+        word_t hi = low64(t) << 1;
+        word_t lo = (high64(t) << 1) | (low64(t) >> 63);
+        word_t q = hi ^ (low64(clmul(hi, k[5])) << 1);
+        __m128i r = clmul(q, k[6]);
+        return lo ^ (high64(r) << 1) ^ (low64(r) >> 63);
+    }
+    __m128i t = clmul(a, b << up);
+    word_t hi = high64(t);
+    word_t q = hi ^ high64(clmul(hi, k[5]));
+    return (low64(t) ^ low64(clmul(q, k[6]))) >> up;
+}
+
+#endif
+
+static word_t multmodp_fast(model_t *model, word_t a, word_t b) {
+#ifdef CLMUL
+    if (have_pclmul())
+        return multmodp_clmul(model, a, b);
+#endif
+    return multmodp_table(model, a, b);
+}
+
+word_t crc_clmul(model_t *model, word_t crc, void const *dat, size_t len)
+{
+    unsigned char const *buf = dat;
+
+    /* if requested, return the initial CRC */
+    if (buf == NULL)
+        return model->init;
+
+#ifdef CLMUL
+    /* fold in as many 16-byte blocks as are available */
+    if (len >= 64 && have_pclmul()) {
+        size_t n = len & ~(size_t)15;
+
+        /* pre-process the CRC */
+        crc ^= model->xorout;
+        if (model->rev)
+            crc = reverse(crc, model->width);
+        crc &= ONES(model->width);
+
+        crc = crc_fold(model, crc, buf, n);
+
+        /* post-process the CRC */
+        if (model->rev)
+            crc = reverse(crc, model->width);
+        crc ^= model->xorout;
+        buf += n;
+        len -= n;
+    }
+#endif
+
+    /* process the remaining bytes, if any */
+    return crc_wordwise(model, crc, buf, len);
+}
+
+word_t crc_clmul512(model_t *model, word_t crc, void const *dat, size_t len)
+{
+    unsigned char const *buf = dat;
+
+    /* if requested, return the initial CRC */
+    if (buf == NULL)
+        return model->init;
+
+#ifdef CLMUL
+    /* fold in as many 16-byte blocks as are available */
+    if (len >= 256 && have_vpclmul()) {
+        size_t n = len & ~(size_t)15;
+
+        /* pre-process the CRC */
+        crc ^= model->xorout;
+        if (model->rev)
+            crc = reverse(crc, model->width);
+        crc &= ONES(model->width);
+
+        crc = crc_fold512(model, crc, buf, n);
+
+        /* post-process the CRC */
+        if (model->rev)
+            crc = reverse(crc, model->width);
+        crc ^= model->xorout;
+        buf += n;
+        len -= n;
+    }
+#endif
+
+    /* process the remaining bytes, if any */
+    return crc_clmul(model, crc, buf, len);
+}
+
+// Return true if model is the Castagnoli CRC-32C polynomial, reflected, with
+// any init and xorout. Such a CRC is a pure CRC-32C register with pre- and
+// post-conditioning.
+static int castagnoli(model_t *model) {
+    return model->width == 32 && model->ref && !model->rev &&
+           model->poly == 0x82f63b78;
+}
+
+// Number of bytes in each of the three streams for long and short inputs.
+#define HW_LONG 8192
+#define HW_SHORT 256
+
+int crc_table_hardware(model_t *model) {
+    if (!castagnoli(model))
+        return 0;
+
+    // The crc32 instruction applied to the carry-less product of a CRC and
+    // x^(n-33) modulo p(x) multiplies the CRC by x^n modulo p(x), where the
+    // extra x^33 is from the product of two reflected values and from the
+    // 32-bit shift done by the instruction.
+    model->table_hw[0] = xnmodp(model, 8 * HW_LONG - 33);
+    model->table_hw[1] = xnmodp(model, 8 * HW_SHORT - 33);
+    return 1;
+}
+
+#ifdef CLMUL
+
+// Compile the crc32 instruction code for processors that have it.
+#define CRC32 __attribute__((target("sse4.2,pclmul")))
+
+// Return true if the processor supports the crc32 instruction. The check is
+// done once, kept as for have_pclmul().
+static int have_crc32(void) {
+    static int have = -1;
+    int got = __atomic_load_n(&have, __ATOMIC_RELAXED);
+    if (got == -1) {
+        unsigned a, b, c, d;
+        got = __get_cpuid(1, &a, &b, &c, &d) && (c & bit_SSE4_2);
+        __atomic_store_n(&have, got, __ATOMIC_RELAXED);
+    }
+    return got;
+}
+
+// Return the CRC-32C register crc multiplied by x^(8 len) modulo p(x), where k
+// is table_hw[] for len.
+CRC32 static inline word_t shift_hw(word_t crc, word_t k) {
+    return _mm_crc32_u64(0, low64(clmul(crc, k)));
+}
+
+// Process len bytes at buf into the pure CRC-32C register crc, by running
+// three independent streams of crc32 instructions, which then are combined.
+// The three streams keep the instruction's pipeline full. If carry-less
+// multiply is not available, then just one stream is used.
+CRC32 static word_t crc_hw(model_t *model, word_t crc,
+                           unsigned char const *buf, size_t len) {
+    // Process bytes up to an eight-byte boundary.
+    while (len && ((uintptr_t)buf & 7)) {
+        crc = _mm_crc32_u8(crc, *buf++);
+        len--;
+    }
+
+    // Process three long streams, and then three short streams, at a time.
+    if (have_pclmul()) {
+        size_t n = HW_LONG;
+        word_t k = model->table_hw[0];
+        for (;;) {
+            while (len >= 3 * n) {
+                unsigned char const *word = buf, *end = buf + n;
+                word_t crc1 = 0, crc2 = 0;
+                do {
+                    crc = _mm_crc32_u64(crc, load(word));
+                    crc1 = _mm_crc32_u64(crc1, load(word + n));
+                    crc2 = _mm_crc32_u64(crc2, load(word + 2 * n));
+                } while ((word += 8) < end);
+                crc = shift_hw(crc, k) ^ crc1;
+                crc = shift_hw(crc, k) ^ crc2;
+                buf += 3 * n;
+                len -= 3 * n;
+            }
+            if (n == HW_SHORT)
+                break;
+            n = HW_SHORT;
+            k = model->table_hw[1];
+        }
+    }
+
+    // Process the remaining words, and then bytes.
+    while (len >= 8) {
+        crc = _mm_crc32_u64(crc, load(buf));
+        buf += 8;
+        len -= 8;
+    }
+    while (len) {
+        crc = _mm_crc32_u8(crc, *buf++);
+        len--;
+    }
+    return crc;
+}
+
+#endif
+
+word_t crc_hardware(model_t *model, word_t crc, void const *dat, size_t len)
+{
+    unsigned char const *buf = dat;
+
+    /* if requested, return the initial CRC */
+    if (buf == NULL)
+        return model->init;
+
+#ifdef CLMUL
+    /* use the crc32 instruction for the pure CRC-32C register */
+    if (castagnoli(model) && have_crc32()) {
+        crc = (crc ^ model->xorout) & 0xffffffff;
+        crc = crc_hw(model, crc, buf, len);
+        return crc ^ model->xorout;
+    }
+#endif
+
+    /* otherwise use the word-wise calculation */
+    return crc_wordwise(model, crc, buf, len);
+}
+
+unsigned crc_cpu(void) {
+    unsigned cpu = 0;
+#ifdef CLMUL
+    if (have_pclmul())
+        cpu |= CRC_CPU_PCLMUL;
+    if (have_vpclmul())
+        cpu |= CRC_CPU_VPCLMUL;
+    if (have_crc32())
+        cpu |= CRC_CPU_CRC32;
+#endif
+    return cpu;
+}
+
+// Upper limits of the short and medium length classes for crc_fast(). Carry-
+// less multiply overtakes the tables at about 64 bytes, and the 512-bit
+// vectors overtake 128-bit vectors at about 256 bytes.
+#define FAST_SHORT 64
+#define FAST_MEDIUM 256
+
+int crc_table_fast(model_t *model) {
+    if (model->width > WORDBITS)
+        return 1;
+    unsigned little = 1;
+    little = *((unsigned char *)(&little));
+
+    // Use the model's own word-wise tables if it already has them for this
+    // processor, or else get them from the registry.
+    if (model->table_word == NULL || model->table_shared ||
+        model->table_little != little || model->table_bits != WORDBITS ||
+        model->slices != WORDCHARS) {
+        int ret = crc_table_shared(model, little, WORDBITS, WORDCHARS);
+        if (ret)
+            return ret;
+    }
+
+    // Pick from the table-driven, carry-less multiply, and hardware routines
+    // according to what the processor supports. The crc32 instruction is the
+    // fastest for short and medium lengths, but folding is faster for long
+    // lengths if the processor has carry-less multiply.
+    unsigned cpu = crc_cpu();
+    crc_func_t *medium;
+    if (cpu & CRC_CPU_PCLMUL) {
+        crc_table_clmul(model);
+        medium = crc_clmul;
+    }
+    else {
+        if (crc_table_braid(model, little))
+            return 2;
+        medium = crc_braid;
+    }
+    model->fast[0] = crc_wordwise;
+    model->fast[1] = medium;
+    model->fast[2] = cpu & CRC_CPU_VPCLMUL ? crc_clmul512 : medium;
+    if (crc_table_hardware(model) && (cpu & CRC_CPU_CRC32)) {
+        model->fast[0] = crc_hardware;
+        model->fast[1] = crc_hardware;
+        if ((cpu & CRC_CPU_PCLMUL) == 0)
+            model->fast[2] = crc_hardware;
+    }
+    return 0;
+}
+
+word_t crc_fast(model_t *model, word_t crc, void const *buf, size_t len)
+{
+    return model->fast[len < FAST_SHORT ? 0 :
+                       len < FAST_MEDIUM ? 1 : 2](model, crc, buf, len);
+}
+
+void crc_multi(model_t *const models[], word_t crcs[], unsigned count,
+               void const *dat, size_t len)
+{
+    unsigned char const *buf = dat;
+
+    // Run each block through all of the models before going on to the next,
+    // so that the block is brought into the cache by the first model, and
+    // the rest get it from there.
+    while (len) {
+        size_t n = len < MULTI_BLOCK ? len : MULTI_BLOCK;
+        for (unsigned k = 0; k < count; k++)
+            crcs[k] = crc_fast(models[k], crcs[k], buf, n);
+        buf += n;
+        len -= n;
+    }
+}
+
+int crc_table_lazy(model_t *model) {
+    if (model->width > WORDBITS)
+        return 1;
+    model->tier = 0;
+    model->seen = 0;
+    return 0;
+}
+
+word_t crc_lazy(model_t *model, word_t crc, void const *buf, size_t len)
+{
+    if (buf == NULL)
+        return model->init;
+
+    // Count the bytes, and move up to the tier for that count if not there
+    // yet. A tier is not entered if its tables could not be built.
+    model->seen += len;
+    if (model->tier < 3 && model->seen >= LAZY_FAST) {
+        if (crc_table_fast(model) == 0)
+            model->tier = 3;
+    }
+    if (model->tier < 2 && model->seen >= LAZY_WORD) {
+        unsigned little = 1;
+        little = *((unsigned char *)(&little));
+        if (crc_table_shared(model, little, WORDBITS, WORDCHARS) == 0) {
+            free(model->table_byte);
+            model->table_byte = NULL;
+            model->tier = 2;
+        }
+    }
+    if (model->tier < 1 && crc_table_bytewise(model) == 0)
+        model->tier = 1;
+
+    switch (model->tier) {
+    case 0:
+        return crc_bitwise(model, crc, buf, len);
+    case 1:
+        return crc_bytewise(model, crc, buf, len);
+    case 2:
+        return crc_wordwise(model, crc, buf, len);
+    default:
+        return crc_fast(model, crc, buf, len);
+    }
 }
@@ -37,44 +37,200 @@ word_t crc_zeros(model_t *, word_t, size_t);
    internal CRC register contents after processing the byte.  If not reflected
    and the CRC width is less than 8, then the CRC is pre-shifted left to the
    high end of the low 8 bits so that the incoming byte can be exclusive-ored
-   directly into a shifted CRC. */
-void crc_table_bytewise(model_t *);
+   directly into a shifted CRC.  model->table_byte is allocated if needed.
+   Return 0 on success, or 2 if out of memory. */
+int crc_table_bytewise(model_t *);
 
 /* Equivalent to crc_bitwise(), but use a faster byte-wise table-based
    approach. This assumes that model->table_byte has been initialized using
-   crc_table_bytewise(). */
+   crc_table_bytewise().  If the word-wise tables have been built by
+   crc_table_wordwise() or crc_table_shared(), then the narrow copy of the
+   byte-wise table stored with them is used instead, which takes less of the
+   cache for short CRCs. */
 word_t crc_bytewise(model_t *, word_t, void const *, size_t);
 
-/* Fill in the tables for a word-wise CRC calculation.  This also fills in the
-   byte-wise table since that is needed for the word-wise calculation. The
+/* Fill in the tables for a word-wise CRC calculation.  A narrow copy of the
+   byte-wise table is stored after them for the bytes before and after the
+   words, so model->table_byte is not needed, and is not built.  The
    second parameter is 1 for little-endian, 0 for big endian. The third
    parameter is the number of bits in a word to use for the tables, which must
-   be 32 or 64. The endian request must match the machine being run on for
-   crc_wordwise() to work. The endian request can be different than the machine
-   being run on when generating code for a different machine.
-
-   The entry in table_word[n][k] is the CRC register contents for the sequence
-   of bytes: k followed by n zero bytes.  For non-reflected CRCs, the CRC is
-   shifted up to the top of the word.  The CRC is byte-swapped if necessary so
-   that the first byte of the CRC to be shifted out is in the same place in the
-   word_t as the first byte that comes from memory.
-
-   If model->ref is true and the request is little-endian, then table_word[0]
-   is the same as table_byte.  In that case, the two could be combined,
-   reducing the total size of the tables.  This is also true if model->ref is
-   false, the request is big-endian, and model->width is equal to word bits. */
-void crc_table_wordwise(model_t *, unsigned, unsigned);
+   be 32 or 64. The endian request and the word size must match the machine
+   being run on for crc_wordwise() to work. The endian request and word size
+   can be different than the machine being run on when generating code for a
+   different machine.
+
+   The fourth parameter is the number of tables, which is the number of bytes
+   processed by each step of crc_wordwise(). It must be a multiple of the
+   number of bytes in a word, and no more than 64. The usual choice is one
+   word, i.e. slice-by-8 for 64-bit words. More slices can be faster on long
+   inputs, at the cost of 256 table entries per slice. model->table_word is
+   allocated or reallocated as needed, and model->slices is set. Return 0 on
+   success, 1 if the parameters are invalid, or 2 if out of memory.
+
+   The word-wise entry for n and k, as returned by crc_table_word(), is the CRC
+   register contents for the sequence of bytes: k followed by n zero bytes.
+   For non-reflected CRCs, the CRC is shifted up to the top of the word.  The
+   CRC is byte-swapped if necessary so that the first byte of the CRC to be
+   shifted out is in the same place in the word_t as the first byte that comes
+   from memory.
+
+   The entries only occupy as many bytes of the word as the CRC does, so they
+   are stored in model->table_word in the narrowest unsigned integer type of
+   1, 2, 4, or WORDCHARS bytes that can hold them, set in model->table_bytes,
+   shifted down by model->table_shift bits.  E.g. the tables for a 16-bit CRC
+   take a quarter of the space of those for a 64-bit CRC, and so a quarter of
+   the cache.  The slices tables are followed by a copy of table_byte in the
+   same type, for use by crc_bytewise() and crc_wordwise().  The stored
+   tables have no initial or final exclusive-or, which crc_bytewise() and
+   crc_wordwise() apply around them, so that they depend only on the width,
+   polynomial, and reflection of the CRC, and not on its init or xorout. */
+int crc_table_wordwise(model_t *, unsigned, unsigned, unsigned);
+
+/* Equivalent to crc_table_wordwise(), but the word-wise tables are taken from
+   a process-wide registry, shared with every other model with the same width,
+   polynomial, and reflection that asks for the same endianess, word size, and
+   number of slices.  E.g. CRC-32 and CRC-32/JAMCRC, which differ only in
+   xorout, use the same tables, whereas CRC-32/BZIP2, which is not reflected,
+   does not.  Each set of tables is built once, by the first model that asks
+   for it, and is never modified after that.  This can be called from any
+   number of threads at once, without a lock.  If two threads build the same
+   set at the same time, then one of them is discarded and both models use
+   the other.  The model does not own the shared tables, and free_model()
+   does not free them.  The byte-wise table_byte is not built, since
+   crc_bytewise() uses the copy stored with the word-wise tables.  Return 0
+   on success, 1 if the parameters are invalid, or 2 if out of memory.
+
+   If the compiler does not provide the GNU C atomic builtins, then this is
+   the same as crc_table_wordwise(), and nothing is shared. */
+int crc_table_shared(model_t *, unsigned, unsigned, unsigned);
+
+/* Free all of the tables in the registry used by crc_table_shared().  This
+   must only be called when no model is using the shared tables, e.g. before
+   exiting a program to verify that all memory is accounted for. */
+void crc_shared_free(void);
+
+/* Return the number of bytes in each entry of the narrow word-wise tables
+   that crc_table_wordwise() would build for a CRC of the given width and
+   reflection, for the endianess and word size of the third and fourth
+   parameters.  The number of bits the entries are shifted down is put in
+   *shift.  This is used to check the tables of a pack in crc_map_open(). */
+unsigned crc_table_narrow(unsigned, unsigned, unsigned, unsigned, unsigned *);
+
+/* Return the word-wise table entry for n and k, where n is less than
+   model->slices, built by crc_table_wordwise() or crc_table_shared().  This
+   includes the initial and final exclusive-or, as used by the generated code,
+   which is not in the stored tables. */
+word_t crc_table_word(model_t *, unsigned, unsigned);
 
 /* Equivalent to crc_bitwise(), but use an even faster word-wise table-based
-   approach.  This assumes that model->table_byte and model->table_word have
-   been initialized using crc_table_wordwise(). */
+   approach, processing model->slices bytes at each step.  This assumes that
+   model->table_word has been initialized using crc_table_wordwise(). */
 word_t crc_wordwise(model_t *, word_t, void const *, size_t);
 
+/* Length of a copy at which crc_copy() uses non-temporal stores, which write
+   around the cache, so that a long copy does not evict the data already in
+   the cache. Define it larger than any copy to always write through the
+   cache, such as when dst will be read again soon. */
+#ifndef COPY_NT
+#  define COPY_NT 4194304
+#endif
+
+/* Equivalent to crc_wordwise() on src[0..len-1], but also copy src[0..len-1]
+   to dst at the same time, storing each word to dst right after it is loaded
+   for the CRC, so that the data is read from memory only once. dst and src
+   must not overlap. Copies of COPY_NT bytes or more use non-temporal stores
+   on x86-64 processors. This assumes the same tables as crc_wordwise(). */
+word_t crc_copy(model_t *, word_t, void *, void const *, size_t);
+
+/* A streaming CRC calculation, for data that arrives in pieces of any size.
+   The members are private to crc_ctx_init(), crc_ctx_update(), and
+   crc_ctx_final(). The CRC register is kept in the form used by the word-wise
+   tables, with the word-wise loop for the model's table entry size and the
+   endianess chosen once by crc_ctx_init(). Less than a word of data that is
+   left over from one update is kept in tail[], to be run with the next, so
+   that the data is processed a word at a time regardless of how it is divided
+   up into pieces. */
+typedef struct crc_ctx_s {
+    model_t *model;             /* the CRC model */
+    void (*update)(struct crc_ctx_s *, void const *, size_t);
+    word_t crc;                 /* the CRC register, in word form */
+    unsigned little;            /* true if little-endian */
+    unsigned have;              /* number of bytes in tail[] */
+    unsigned char tail[WORDCHARS];      /* data not yet run */
+} crc_ctx_t;
+
+/* Start a streaming CRC calculation for the model in *ctx, continuing from
+   the CRC in the third argument, which is model->init to start a new CRC.
+   This assumes that the word-wise tables have been
+   initialized for the machine being run on using crc_table_wordwise(),
+   crc_table_shared(), or crc_map_model(), and that model->width is no more
+   than WORDBITS. */
+void crc_ctx_init(crc_ctx_t *, model_t *, word_t);
+
+/* Run buf[0..len-1] through the streaming CRC calculation in *ctx. */
+void crc_ctx_update(crc_ctx_t *, void const *, size_t);
+
+/* Return the CRC of all of the data given to crc_ctx_update() since
+   crc_ctx_init(). *ctx is not changed, so more data can be run through it
+   after this for the CRC of a longer sequence. */
+word_t crc_ctx_final(crc_ctx_t const *);
+
+/* The number of messages that crc_batch() advances together. */
+#ifndef BATCH
+#  define BATCH 4
+#endif
+
+/* Replace each crcs[i] for i in 0..n-1 with the CRC of bufs[i][0..lens[i]-1]
+   continuing from crcs[i], which is model->init for a new CRC, using the
+   word-wise tables. The messages are computed BATCH at a time, a word from
+   each in turn, so that the lookups for one message overlap with those for
+   the others, instead of each waiting on the one before it. When a message
+   ends, the next one takes its place, so the messages can have any mix of
+   lengths. This assumes the same tables as crc_wordwise(). */
+void crc_batch(model_t *, void const *const [], size_t const [], word_t [],
+               size_t);
+
+/* The number of independent CRC lanes used by crc_braid(). Each lane operates
+   on every BRAIDS'th word_t of the input. */
+#ifndef BRAIDS
+#  define BRAIDS 5
+#endif
+
+/* Fill in the tables for a braided word-wise CRC calculation. This assumes
+   that the word-wise tables have been initialized for the machine being run
+   on using crc_table_wordwise() or crc_table_shared(), with any number of
+   slices, since those are needed for the braided calculation. The byte-wise
+   table is built here, to compute the braid tables. The second parameter is 1
+   for little-endian, 0 for big-endian, and must match the machine being run
+   on.
+
+   The entry in table_braid[n][k] is the CRC register contents for the sequence
+   of bytes: k followed by n + (BRAIDS - 1) * WORDCHARS zero bytes, with no
+   initial or final exclusive-or. That is the effect of a byte in a word on the
+   CRC register of its lane when the lane gets to its next word. The entries
+   are shifted and swapped as for the word-wise tables. model->table_braid is
+   allocated if needed. Return 0 on success, or 2 if out of memory. */
+int crc_table_braid(model_t *, unsigned);
+
+/* Equivalent to crc_bitwise(), but use a braided word-wise table-based
+   approach. BRAIDS CRCs are computed independently on interleaved word_t's,
+   and merged at the end, so that the table lookups for one lane do not have
+   to wait for those of the previous word. This assumes that the tables have
+   been initialized using crc_table_braid(). crc_wordwise() is used for short
+   lengths and for the bytes before and after the braided words. */
+word_t crc_braid(model_t *, word_t, void const *, size_t);
+
 /* Fill in model->table_comb[n] for combining CRCs. Each entry is x raised to
    the 2 to the n+3 power, modulo the CRC polynomial. Set model->cycle to the
    cycle length, or WORDBITS if the powers did not cycle. model->cycle entries
-   of model->table_comb[] will be filled in. */
-void crc_table_combine(model_t *);
+   of model->table_comb[] will be filled in. Also fill in model->table_pow[i][k]
+   with x raised to the 8 k 16^i power, modulo the CRC polynomial, so that the
+   power of x for any length can be had with one multiplication per
+   hexadecimal digit of the length. The byte-wise table and the Barrett
+   reduction constants in table_clmul[] are filled in as well, to speed up the
+   multiplications. The tables are allocated if needed. Return 0 on success,
+   or 2 if out of memory. */
+int crc_table_combine(model_t *);
 
 /* Combine the CRC of the first portion of the message in the second argument
    with the CRC of the second portion in the third argument, returning the CRC
@@ -83,4 +239,121 @@ void crc_table_combine(model_t *);
    has been filled in by crc_table_combine(). */
 word_t crc_combine(model_t *, word_t, word_t, uintmax_t);
 
+/* Equivalent to crc_zeros(), but take time proportional to the logarithm of
+   the count instead of the count, by multiplying the CRC by a power of x
+   taken from the tables for combining CRCs. This assumes that the tables have
+   been initialized using crc_table_combine(). */
+word_t crc_zeros_fast(model_t *, word_t, uintmax_t);
+
+/* Fill in model->table_clmul[] with the constants needed to compute the CRC
+   using carry-less multiplication. The constants are powers of x modulo the
+   CRC polynomial for folding 2048, 512, and 128 bits of data forward, and the
+   constants for a Barrett reduction of the final 128 bits to the CRC. Any CRC
+   up to 64 bits in width can be computed this way. */
+void crc_table_clmul(model_t *);
+
+/* Equivalent to crc_bitwise(), but use the carry-less multiply instruction to
+   fold 64 bytes of data into the CRC at each step, if the processor has that
+   instruction. This assumes that model->table_clmul has been initialized using
+   crc_table_clmul(), and that the tables used by crc_wordwise() have been
+   initialized, since crc_wordwise() is used for short lengths, for the bytes
+   left over after folding, or if carry-less multiply is not available. */
+word_t crc_clmul(model_t *, word_t, void const *, size_t);
+
+/* Equivalent to crc_clmul(), but use the 512-bit vector carry-less multiply
+   instruction to fold 256 bytes of data into the CRC at each step, if the
+   processor has that instruction and the operating system supports 512-bit
+   vectors. Otherwise, or for short lengths, crc_clmul() is used. This uses
+   the same tables as crc_clmul(). */
+word_t crc_clmul512(model_t *, word_t, void const *, size_t);
+
+/* Return true if the model is CRC-32C, i.e. the reflected Castagnoli
+   polynomial 0x1edc6f41, with any init and xorout, and if so fill in
+   model->table_hw[] with the constants needed to combine the streams of
+   crc_hardware(). Return false otherwise, in which case crc_hardware() will
+   use crc_wordwise(). */
+int crc_table_hardware(model_t *);
+
+/* Equivalent to crc_bitwise(), but use the SSE4.2 crc32 instruction, if the
+   model is CRC-32C and the processor has that instruction. Three streams of
+   instructions are run on separate portions of the data, and then combined
+   using carry-less multiplication, if the processor has it. The model's init
+   and xorout are applied around the instruction's pure CRC-32C register. This
+   assumes that crc_table_hardware() has been called, and that the tables used
+   by crc_wordwise() have been initialized, since crc_wordwise() is used for
+   other models or if the instruction is not available. */
+word_t crc_hardware(model_t *, word_t, void const *, size_t);
+
+/* Processor features used by the CRC routines, as returned by crc_cpu(). */
+#define CRC_CPU_PCLMUL 1        /* carry-less multiply (crc_clmul()) */
+#define CRC_CPU_VPCLMUL 2       /* 512-bit carry-less multiply (crc_clmul512()) */
+#define CRC_CPU_CRC32 4         /* SSE4.2 crc32 instruction (crc_hardware()) */
+
+/* Return the processor features available to the CRC routines, as the
+   CRC_CPU_* bits. The processor is probed once, on the first call. Zero is
+   returned for processors other than x86-64. */
+unsigned crc_cpu(void);
+
+/* Fill in the tables for the CRC routines that can be used on the processor
+   being run on, and set model->fast[] to the fastest of those routines for
+   each class of input lengths, for crc_fast(). This uses the native word size
+   and endianess. Return 0 on success, 1 if model->width is greater than
+   WORDBITS, or 2 if out of memory. The word-wise tables are obtained from
+   crc_table_shared(), so models that differ only in init or xorout share
+   them, unless the model already has private tables from crc_table_wordwise()
+   with the native word size and endianess and one word of slices, in which
+   case those are used. */
+int crc_table_fast(model_t *);
+
+/* Equivalent to crc_bitwise(), but use the fastest routine available on the
+   processor being run on for the length of the input, as selected by
+   crc_table_fast(), which must have been called for the model. */
+word_t crc_fast(model_t *, word_t, void const *, size_t);
+
+/* Number of bytes that crc_multi() runs through all of the models at a time.
+   This should be small enough to stay in the cache closest to the processor
+   along with the tables of the models. */
+#ifndef MULTI_BLOCK
+#  define MULTI_BLOCK 16384
+#endif
+
+/* Replace each crcs[k] for k in 0..count-1 with the CRC for models[k] of
+   buf[0..len-1], continuing from crcs[k], which is models[k]->init for a new
+   CRC. The data is run through all of the models a block of MULTI_BLOCK bytes
+   at a time, so that the data is read from memory once, regardless of the
+   number of models, with each model using the fastest routine for it on the
+   processor. This assumes that crc_table_fast() has been called for each of
+   the models. */
+void crc_multi(model_t *const [], word_t [], unsigned, void const *, size_t);
+
+/* Number of bytes run through crc_lazy() for a model before it builds the
+   word-wise tables, and before it builds the tables for crc_fast(). Until the
+   first, the byte-wise table is used. */
+#ifndef LAZY_WORD
+#  define LAZY_WORD 16384
+#endif
+#ifndef LAZY_FAST
+#  define LAZY_FAST 1048576
+#endif
+
+/* Prepare the model for crc_lazy(), without building any tables. Return 0 on
+   success, or 1 if model->width is greater than WORDBITS. */
+int crc_table_lazy(model_t *);
+
+/* Equivalent to crc_bitwise(), but build the tables for the model as they
+   are needed by the amount of data the model has been used on. The byte-wise
+   table is built on the first call. Once LAZY_WORD bytes have been run
+   through crc_lazy() for the model, the word-wise tables are obtained from
+   crc_table_shared(), and the byte-wise table is freed, since a copy comes
+   with the word-wise tables. Once LAZY_FAST bytes have been run through, the
+   tables for crc_fast() are built. A single call with that much data builds
+   them right away. Then a model that is only used on short messages costs
+   only a byte-wise table, and one that is never used costs nothing. If the
+   tables for a tier cannot be built for lack of memory, the current tier
+   continues to be used, or crc_bitwise() if there are no tables. This
+   assumes that crc_table_lazy() has been called for the model. As for the
+   other table-building routines, the model must not be used by another
+   thread during a call, since the tables may be changed. */
+word_t crc_lazy(model_t *, word_t, void const *, size_t);
+
 #endif
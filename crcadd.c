@@ -147,15 +147,23 @@ static int create_source(char *src, char *name, FILE **head, FILE **code) {
 // Subdirectory for source files.
 #define SRC "src"
 
+// Base name of the source files for the tables shared by the CRCs.
+#define TABLES "crctables"
+
 // Read CRC models from stdin, one per line, and generate C tables and routines
 // to compute each one. Each CRC goes into it's own .h and .c source files in
-// the "src" subdirectory of the current directory.
+// the "src" subdirectory of the current directory, with its own tables, so
+// that CRCs can be added to src one run at a time. If -t is given, then the
+// CRCs of this run share their tables in a new crctables.[ch] there.
 int main(int argc, char **argv) {
     // Set endianess default to be that of this machine, and bits of the
     // largest integer type for this machine. (Usually 64.)
     unsigned little = 1;
     little = *((unsigned char *)(&little));
     int bits = INTMAX_BITS;
+    unsigned slices = 0;
+    unsigned braids = 0;
+    int shared = 0;
 
     // Process options for generated code endianess and word bits.
     for (int i = 1; i < argc; i++)
@@ -171,11 +179,46 @@ int main(int argc, char **argv) {
                 case '4':
                     bits = 32;
                     break;
+                case 's':
+                    slices = 0;
+                    while (opt[1] >= '0' && opt[1] <= '9')
+                        slices = slices * 10 + (*++opt - '0');
+                    if (slices == 0 || slices > 64) {
+                        fputs("-s needs a number of bytes, up to 64\n",
+                              stderr);
+                        return 1;
+                    }
+                    break;
+                case 'i':
+                    braids = 1;         // crc_gen() picks the lanes
+                    if (opt[1] < '0' || opt[1] > '9')
+                        break;
+                    braids = 0;
+                    while (opt[1] >= '0' && opt[1] <= '9')
+                        braids = braids * 10 + (*++opt - '0');
+                    if (braids < 2 || braids > 64) {
+                        fputs("-i needs a number of lanes, from 2 to 64\n",
+                              stderr);
+                        return 1;
+                    }
+                    break;
+                case 't':
+                    shared = 1;
+                    break;
                 case 'h':
-                    fputs("usage: crcadd [-b] [-l] [-4] < crc-defs\n"
+                    fputs("usage: crcadd [-b] [-l] [-4] [-sn] [-i[n]] [-t]"
+                          " < crc-defs\n"
                           "    -b for big endian\n"
                           "    -l (ell) for little endian\n"
-                          "    -4 for four-byte words\n", stderr);
+                          "    -4 for four-byte words\n"
+                          "    -sn for n bytes per word-wise step, a multiple"
+                          " of the word size\n"
+                          "    -i[n] for a braided routine with n interleaved"
+                          " lanes, or the\n"
+                          "        number of lanes picked for the word size"
+                          "\n"
+                          "    -t for the CRCs to share their tables in a new"
+                          " crctables.[ch]\n", stderr);
                     return 0;
                 default:
                     fprintf(stderr, "unknown option: %c\n", *opt);
@@ -185,6 +228,31 @@ int main(int argc, char **argv) {
             fputs("must precede options with a dash\n", stderr);
             return 1;
         }
+    if (slices % (bits >> 3)) {
+        fprintf(stderr, "-s%u is not a multiple of the word size\n", slices);
+        return 1;
+    }
+    if (braids * (bits >> 3) > 64) {
+        fprintf(stderr, "-i%u is too many lanes for the word size\n", braids);
+        return 1;
+    }
+
+    // create the shared table section, if requested
+    FILE *tabh = NULL, *tabc = NULL;
+    share_t *share = NULL;
+    if (shared) {
+        int ret = create_source(SRC, TABLES, &tabh, &tabc);
+        if (ret) {
+            fprintf(stderr, "%s/%s.[ch] %s -- aborting\n", SRC, TABLES,
+                    ret == 1 ? "create error" : "exists (add without -t)");
+            return 1;
+        }
+        share = share_new(TABLES, tabh, tabc);
+        if (share == NULL) {
+            fputs("out of memory -- aborting\n", stderr);
+            return 1;
+        }
+    }
 
     // read each line from stdin, process the CRC description
     char *line = NULL;
@@ -226,14 +294,20 @@ int main(int argc, char **argv) {
                 fprintf(stderr, "%s/%s.[ch] %s -- skipping\n", SRC, name,
                         errno == 1 ? "create error" : "exists");
             else {
-                crc_gen(&model, name, little, bits, head, code);
+                crc_gen(&model, name, little, bits, slices, braids, share,
+                        head, code);
                 fclose(code);
                 fclose(head);
             }
             free(name);
         }
-        free(model.name);
+        free_model(&model);
     }
     free(line);
+    if (share != NULL) {
+        share_free(share);
+        fclose(tabc);
+        fclose(tabh);
+    }
     return 0;
 }
@@ -55,12 +55,13 @@ static int strncmpi(char const *s1, char const *s2, size_t n) {
 
 // Generate test code for model and name. Append the include for the header
 // file for this model to defs, test code for each function for this model to
-// test, a unified interface to the word-wise function of this model to allc,
-// and a table of names, widths, and function pointers to allh. The test code
+// test, including _braid if braids is not zero, a unified interface to the
+// fastest function of this model to allc, and a table of names, widths, and
+// function pointers to allh. The test code
 // computes the CRC of "123456789" (nine bytes), and compares that to the
 // provided check value. If the check value does not match the computed CRC,
 // then the generated code prints an error to stderr.
-static int test_gen(model_t *model, char *name,
+static int test_gen(model_t *model, char *name, unsigned braids,
                     FILE *defs, FILE *test, FILE *allc, FILE *allh) {
     // write test and all code for bit-wise function
     fprintf(defs,
@@ -78,7 +79,7 @@ static int test_gen(model_t *model, char *name,
         "\n"
         "#include \"%s.h\"\n"
         "uintmax_t %s(uintmax_t crc, void const *mem, size_t len) {\n"
-        "    return %s_word(crc, mem, len);\n"
+        "    return %s_clmul(crc, mem, len);\n"
         "}\n", name, name, name);
     fprintf(allh,
         "    {\"%s\", \"", model->name);
@@ -118,6 +119,24 @@ static int test_gen(model_t *model, char *name,
         "        fputs(\"word-wise mismatch for %s\\n\", stderr), err++;\n",
             name, name, model->check, name, name);
 
+    // write test code for braided function, if generated
+    if (braids)
+        fprintf(test,
+        "    if (%s_braid(0, NULL, 0) != init ||\n"
+        "        %s_braid(blot, \"123456789\", 9) != %#"X" ||\n"
+        "        %s_braid(blot, data + 1, sizeof(data) - 1) != crc)\n"
+        "        fputs(\"braided mismatch for %s\\n\", stderr), err++;\n",
+            name, name, model->check, name, name);
+
+    // write test code for carry-less multiply function
+    fprintf(test,
+        "    if (%s_clmul(0, NULL, 0) != init ||\n"
+        "        %s_clmul(blot, \"123456789\", 9) != %#"X" ||\n"
+        "        %s_clmul(blot, data + 1, sizeof(data) - 1) != crc)\n"
+        "        fputs(\"carry-less multiply mismatch for %s\\n\", stderr), "
+                                                                "err++;\n",
+            name, name, model->check, name, name);
+
     // write test code for combination function
     fprintf(test,
         "    if (%s_comb(\n"
@@ -125,6 +144,24 @@ static int test_gen(model_t *model, char *name,
         "            %s_byte(init, data + cut, 23), 23) != crc)\n"
         "        fputs(\"combination mismatch for %s\\n\", stderr), err++;\n",
             name, name, name, name);
+
+    // write test code for shift function, against the byte-wise function
+    // over zeros for short lengths, and for consistency with itself for
+    // lengths that use all of the powers
+    fprintf(test,
+        "    for (size_t n = 0; n <= sizeof(zeros); n++)\n"
+        "        if (%s_shift(crc, n) != %s_byte(crc, zeros, n)) {\n"
+        "            fputs(\"shift mismatch for %s\\n\", stderr), err++;\n"
+        "            break;\n"
+        "        }\n"
+        "    for (uintmax_t n = 1; n >> 62 == 0; n = 3 * n + 1)\n"
+        "        if (%s_shift(%s_shift(crc, n), n + 5) !=\n"
+        "            %s_shift(crc, 2 * n + 5)) {\n"
+        "            fputs(\"long shift mismatch for %s\\n\", stderr), "
+                                                                "err++;\n"
+        "            break;\n"
+        "        }\n",
+            name, name, name, name, name, name, name);
     return 0;
 }
 
@@ -225,15 +262,53 @@ static int create_source(char *src, char *name, FILE **head, FILE **code) {
 // Subdirectory for source files.
 #define SRC "src"
 
+// Base name of the source files for the tables shared by the CRCs.
+#define TABLES "crctables"
+
 // Read CRC models from stdin, one per line, and generate C tables and routines
 // to compute each one. Each CRC goes into it's own .h and .c source files in
-// the "src" subdirectory of the current directory.
-int main(void) {
+// the "src" subdirectory of the current directory, with the tables shared by
+// them in crctables.[ch] there. The option -sn sets the number of bytes
+// processed at each step of the word-wise routines, and -i[n] generates and
+// tests the braided routines, as for crcadd.
+int main(int argc, char **argv) {
     // determine endianess of this machine (for testing on this machine, we
     // need to match its endianess)
     unsigned little = 1;
     little = *((unsigned char *)(&little));
 
+    // get the number of bytes per word-wise step and the number of braided
+    // lanes, if given
+    unsigned slices = 0, braids = 0;
+    for (int i = 1; i < argc; i++) {
+        char *end;
+        if (strncmp(argv[i], "-s", 2) == 0) {
+            slices = strtoul(argv[i] + 2, &end, 10);
+            if (*end || slices == 0 || slices > 64 ||
+                slices % (INTMAX_BITS >> 3)) {
+                fputs("-sn needs a multiple of the word size, up to 64\n",
+                      stderr);
+                return 1;
+            }
+        }
+        else if (strncmp(argv[i], "-i", 2) == 0) {
+            braids = 1;                 // crc_gen() picks the lanes
+            if (argv[i][2]) {
+                braids = strtoul(argv[i] + 2, &end, 10);
+                if (*end || braids < 2 ||
+                    braids * (INTMAX_BITS >> 3) > 64) {
+                    fputs("-in needs a number of lanes that fits in 64 "
+                          "bytes\n", stderr);
+                    return 1;
+                }
+            }
+        }
+        else {
+            fputs("usage: crcall [-sn] [-i[n]] < crc-defs\n", stderr);
+            return 1;
+        }
+    }
+
     // create test source files
     FILE *defs, *test, *allc, *allh;
     if (create_source(SRC, "test_src", &defs, &test) ||
@@ -241,6 +316,19 @@ int main(void) {
         fputs("could not create test code files -- aborting\n", stderr);
         return 1;
     }
+
+    // create the shared table section
+    FILE *tabh, *tabc;
+    share_t *share;
+    if (create_source(SRC, TABLES, &tabh, &tabc)) {
+        fputs("could not create table files -- aborting\n", stderr);
+        return 1;
+    }
+    share = share_new(TABLES, tabh, tabc);
+    if (share == NULL) {
+        fputs("out of memory -- aborting\n", stderr);
+        return 1;
+    }
     fputs(
         "#include <stdio.h>\n"
         "#include <stdlib.h>\n"
@@ -249,7 +337,8 @@ int main(void) {
         "#include \"test_src.h\"\n"
         "\n"
         "int main(void) {\n"
-        "    unsigned char data[31];\n"
+        "    unsigned char data[1031];\n"
+        "    static unsigned char const zeros[259];\n"
         "    {\n"
         "        unsigned max = (unsigned)RAND_MAX + 1;\n"
         "        int shft = 0;\n"
@@ -321,14 +410,15 @@ int main(void) {
                 fprintf(stderr, "%s/%s.[ch] %s -- skipping\n", SRC, name,
                         errno == 1 ? "create error" : "exists");
             else {
-                crc_gen(&model, name, little, INTMAX_BITS, head, code);
-                test_gen(&model, name, defs, test, allc, allh);
+                crc_gen(&model, name, little, INTMAX_BITS, slices, braids,
+                        share, head, code);
+                test_gen(&model, name, braids, defs, test, allc, allh);
                 fclose(code);
                 fclose(head);
             }
             free(name);
         }
-        free(model.name);
+        free_model(&model);
     }
     free(line);
 
@@ -346,5 +436,8 @@ int main(void) {
         "}\n", test);
     fclose(test);
     fclose(defs);
+    share_free(share);
+    fclose(tabc);
+    fclose(tabh);
     return 0;
 }
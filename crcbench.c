@@ -0,0 +1,470 @@
+/* crcbench.c -- Generic CRC speed comparisons
+ * Copyright (C) 2021 Mark Adler
+ * For conditions of distribution and use, see copyright notice in crcany.c.
+ */
+
+/*
+   Read a series of CRC model descriptions from stdin, one per line, in the
+   same form as for crctest, and measure the speed of each of the table-driven,
+   braided, and carry-less multiply CRC calculations for each model, in GB/s.
+   The CRCs are computed over a buffer of random data that fits in the L2
+   cache, so that the speed of the calculation is measured, not the speed of
+   memory.
+
+   The carry-less multiply calculations fall back to the next slower method
+   if the processor does not have the instructions needed, in which case their
+   speeds will be the same as for that method. The hardware calculation is
+   only for CRC-32C models, and is the same as word-wise for the others. The
+   fast calculation is whichever of those crc_table_fast() picked for long
+   inputs on this processor. For CRCs longer than a word_t, the byte-wise and
+   word-wise speeds are for the double-word tables, followed by the speed of
+   the bit-wise calculation for comparison.
+
+   With the -s option, instead measure the speed of the word-wise calculation
+   for each number of slices from one word up to 64 bytes, doubling each time.
+   The header shows the number of word-wise table entries for each, and each
+   line ends with the number of bytes per entry for that CRC, to compare the
+   speed with the footprint in the L1 cache.
+
+   With the -t option, instead measure the time it takes to build the tables
+   for each model, in microseconds, as a program that uses a CRC only briefly
+   would need to do at startup. The columns are for the byte-wise table, the
+   word-wise tables with one word of slices and with 64 slices, the braid
+   tables, the combination tables, and all of the tables used by crc_fast().
+   Private tables are built for crc_fast(), without using the registry of
+   shared tables. The last column is the time to instead get the word-wise
+   tables from that registry once they are there. For CRCs longer than a word_t, the double-word tables are
+   timed under word. The total over all of the models is shown at the end.
+
+   With the -f option, instead measure the speed of computing the CRC of the
+   data delivered in fragments of 1 to 100 bytes, as from network reads. The
+   columns are crc_wordwise() called on each fragment, the streaming
+   crc_ctx_update() on each fragment, and crc_wordwise() on all of the data at
+   once for comparison.
+
+   With the -b option, instead measure the speed of computing the CRCs of many
+   separate messages of 16 to 256 bytes, as for a stream of records. The
+   columns are crc_wordwise() called on each message, and crc_batch() called
+   on all of them.
+
+   With the -c option, instead measure the speed of copying data while
+   computing its CRC, with memcpy() followed by crc_wordwise() on the copy, and
+   with crc_copy(), first for data that fits in the L2 cache, and then for
+   COPY_LEN bytes, which does not fit in the cache and uses non-temporal
+   stores in crc_copy() on x86-64.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+#include "model.h"
+#include "crc.h"
+#include "crcdbl.h"
+
+// Number of bytes of data to compute the CRCs on.
+#define LEN 262144
+
+// Number of bytes of data to copy for the out-of-cache speeds of -c.
+#define COPY_LEN 67108864
+
+// Accumulate the computed CRCs here, so that the calculations are not
+// optimized away.
+static volatile word_t sink;
+
+// Return the current time in seconds.
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// Return the speed of func in GB/s computing the CRC of len bytes at buf,
+// repeating the calculation until at least a tenth of a second has passed.
+static double speed(crc_func_t *func, model_t *model,
+                    void const *buf, size_t len) {
+    word_t crc = func(model, 0, NULL, 0);
+    double start = now(), end;
+    unsigned long reps = 0;
+    do {
+        for (int i = 0; i < 16; i++)
+            crc = func(model, crc, buf, len);
+        reps += 16;
+        end = now();
+    } while (end - start < 0.1);
+    sink ^= crc;
+    return reps * (double)len / (end - start) * 1e-9;
+}
+
+// Type of a CRC calculation routine for CRCs longer than a word_t.
+typedef void crc_dbl_func_t(model_t *, word_t *, word_t *,
+                            unsigned char const *, size_t);
+
+// Same as speed(), but for a CRC longer than a word_t.
+static double speed_dbl(crc_dbl_func_t *func, model_t *model,
+                        unsigned char const *buf, size_t len) {
+    word_t hi, lo;
+    func(model, &hi, &lo, NULL, 0);
+    double start = now(), end;
+    unsigned long reps = 0;
+    do {
+        for (int i = 0; i < 16; i++)
+            func(model, &hi, &lo, buf, len);
+        reps += 16;
+        end = now();
+    } while (end - start < 0.1);
+    sink ^= hi ^ lo;
+    return reps * (double)len / (end - start) * 1e-9;
+}
+
+// Lengths of the fragments for -f, from 1 to 100 bytes, which add up to LEN.
+static size_t frag[LEN];
+static size_t frags;
+
+// Return the speed in GB/s of func computing the CRC of the data at buf in the
+// fragments in frag[], or of crc_ctx_update() if func is NULL.
+static double speed_frag(crc_func_t *func, model_t *model,
+                         unsigned char const *buf) {
+    crc_ctx_t ctx;
+    crc_ctx_init(&ctx, model, model->init);
+    word_t crc = model->init;
+    double start = now(), end;
+    unsigned long reps = 0;
+    do {
+        unsigned char const *p = buf;
+        if (func == NULL)
+            for (size_t i = 0; i < frags; i++) {
+                crc_ctx_update(&ctx, p, frag[i]);
+                p += frag[i];
+            }
+        else
+            for (size_t i = 0; i < frags; i++) {
+                crc = func(model, crc, p, frag[i]);
+                p += frag[i];
+            }
+        reps++;
+        end = now();
+    } while (end - start < 0.1);
+    sink ^= crc ^ crc_ctx_final(&ctx);
+    return reps * (double)LEN / (end - start) * 1e-9;
+}
+
+// Messages for -b, of 16 to 256 bytes, which add up to LEN, and their CRCs.
+static void const *rec[LEN / 16];
+static size_t reclen[LEN / 16];
+static word_t reccrc[LEN / 16];
+static size_t recs;
+
+// Return the speed in GB/s of computing the CRCs of the messages in rec[],
+// with crc_batch() if batch is true, or else with crc_wordwise() on each.
+static double speed_batch(model_t *model, int batch) {
+    double start = now(), end;
+    unsigned long reps = 0;
+    do {
+        for (size_t i = 0; i < recs; i++)
+            reccrc[i] = model->init;
+        if (batch)
+            crc_batch(model, rec, reclen, reccrc, recs);
+        else
+            for (size_t i = 0; i < recs; i++)
+                reccrc[i] = crc_wordwise(model, reccrc[i], rec[i],
+                                         reclen[i]);
+        reps++;
+        end = now();
+    } while (end - start < 0.1);
+    for (size_t i = 0; i < recs; i++)
+        sink ^= reccrc[i];
+    return reps * (double)LEN / (end - start) * 1e-9;
+}
+
+// Return the speed in GB/s of copying len bytes from src to dst and
+// computing their CRC, with crc_copy() if fused is true, or else memcpy() and
+// then crc_wordwise() on dst.
+static double speed_copy(model_t *model, unsigned char *dst,
+                         unsigned char const *src, size_t len, int fused) {
+    word_t crc = model->init;
+    double start = now(), end;
+    unsigned long reps = 0;
+    do {
+        if (fused)
+            crc = crc_copy(model, crc, dst, src, len);
+        else {
+            memcpy(dst, src, len);
+            crc = crc_wordwise(model, crc, dst, len);
+        }
+        reps++;
+        end = now();
+    } while (end - start < 0.1);
+    sink ^= crc;
+    return reps * (double)len / (end - start) * 1e-9;
+}
+
+// Type of a table building routine to time, for the endianess little.
+typedef int table_func_t(model_t *, unsigned);
+
+// Table building routines for setup().
+static int build_byte(model_t *model, unsigned little) {
+    (void)little;
+    return crc_table_bytewise(model);
+}
+static int build_word(model_t *model, unsigned little) {
+    return crc_table_wordwise(model, little, WORDBITS, WORDCHARS);
+}
+static int build_word64(model_t *model, unsigned little) {
+    return crc_table_wordwise(model, little, WORDBITS, 64);
+}
+static int build_braid(model_t *model, unsigned little) {
+    return crc_table_braid(model, little);
+}
+static int build_combine(model_t *model, unsigned little) {
+    (void)little;
+    return crc_table_combine(model);
+}
+static int build_fast(model_t *model, unsigned little) {
+    // crc_table_fast() uses the private tables instead of the registry
+    int ret = crc_table_wordwise(model, little, WORDBITS, WORDCHARS);
+    return ret ? ret : crc_table_fast(model);
+}
+static int build_lookup(model_t *model, unsigned little) {
+    return crc_table_shared(model, little, WORDBITS, WORDCHARS);
+}
+static int build_dbl(model_t *model, unsigned little) {
+    (void)little;
+    return crc_table_dbl(model);
+}
+
+// Return the time in microseconds for build to build its tables for model,
+// repeating until at least a hundredth of a second has passed. The tables
+// are allocated before timing, so that only their calculation is measured.
+// Return -1 if build fails.
+static double setup(table_func_t *build, model_t *model, unsigned little) {
+    if (build(model, little))
+        return -1;
+    double start = now(), end;
+    unsigned long reps = 0;
+    do {
+        for (int i = 0; i < 16; i++)
+            build(model, little);
+        reps += 16;
+        end = now();
+    } while (end - start < 0.01);
+    return (end - start) / reps * 1e6;
+}
+
+int main(int argc, char **argv) {
+    int curve = argc > 1 && strcmp(argv[1], "-s") == 0;
+    int init = argc > 1 && strcmp(argv[1], "-t") == 0;
+    int split = argc > 1 && strcmp(argv[1], "-f") == 0;
+    int copy = argc > 1 && strcmp(argv[1], "-c") == 0;
+    int batch = argc > 1 && strcmp(argv[1], "-b") == 0;
+    if (argc > 2 ||
+        (argc > 1 && !curve && !init && !split && !copy && !batch)) {
+        fputs("usage: crcbench [-s | -t | -f | -b | -c] < models\n", stderr);
+        return 1;
+    }
+
+    unsigned char *data = malloc(LEN);
+    unsigned char *from = NULL, *to = NULL;
+    if (copy) {
+        from = malloc(COPY_LEN);
+        to = malloc(COPY_LEN);
+    }
+    if (data == NULL || (copy && (from == NULL || to == NULL))) {
+        fputs("out of memory -- aborting\n", stderr);
+        return 1;
+    }
+    srand(time(NULL));
+    for (size_t n = 0; n < LEN; n++)
+        data[n] = rand() >> 7;
+    if (copy)
+        for (size_t n = 0; n < COPY_LEN; n++)
+            from[n] = rand() >> 7;
+    unsigned little = 1;
+    little = *((unsigned char *)(&little));
+    for (size_t left = LEN; left; left -= frag[frags++])
+        frag[frags] = left < 100 ? left : 1 + (size_t)rand() % 100;
+    for (size_t at = 0; at < LEN; at += reclen[recs++]) {
+        rec[recs] = data + at;
+        reclen[recs] = LEN - at < 272 ? LEN - at : 16 + (size_t)rand() % 241;
+    }
+
+    if (curve) {
+        printf("%-26s", "slices");
+        for (unsigned n = WORDCHARS; n <= 64; n <<= 1)
+            printf(" %8u", n);
+        printf("\n%-26s", "table entries");
+        for (unsigned n = WORDCHARS; n <= 64; n <<= 1)
+            printf(" %8u", n << 8);
+        puts("  (GB/s, bytes per entry)");
+    }
+    else if (split)
+        printf("%-26s %8s %8s %8s  (GB/s)\n",
+               "model", "word", "stream", "whole");
+    else if (batch)
+        printf("%-26s %8s %8s  (GB/s)\n", "model", "word", "batch");
+    else if (copy)
+        printf("%-26s %8s %8s %8s %8s  (GB/s)\n",
+               "model", "memcpy", "copy", "mem64M", "copy64M");
+    else if (init)
+        printf("%-26s %8s %8s %8s %8s %8s %8s %8s  (us)\n",
+               "model", "byte", "word", "word64", "braid", "combine", "fast",
+               "lookup");
+    else
+        printf("%-26s %8s %8s %8s %8s %8s %8s %8s  (GB/s)\n",
+               "model", "byte", "word", "braid", "clmul", "clmul512", "hw",
+               "fast");
+    double total = 0;
+    char *line = NULL;
+    size_t size;
+    ptrdiff_t len;
+    model_t model;
+    model.name = NULL;
+    int oom = 0;
+    while ((len = getcleanline(&line, &size, stdin)) != -1) {
+        if (len == 0)
+            continue;
+        int ret = read_model(&model, line, 1);
+        if (ret == 2) {
+            fputs("out of memory -- aborting\n", stderr);
+            oom = 1;
+            break;
+        }
+        if (ret == 0 && init) {
+            process_model(&model);
+            double t[7];
+            if (model.width <= WORDBITS) {
+                t[0] = setup(build_byte, &model, little);
+                t[1] = setup(build_word, &model, little);
+                t[2] = setup(build_word64, &model, little);
+                t[3] = setup(build_braid, &model, little);
+                t[4] = setup(build_combine, &model, little);
+                t[5] = setup(build_fast, &model, little);
+                t[6] = setup(build_lookup, &model, little);
+            }
+            else {
+                t[0] = t[2] = t[3] = t[4] = t[5] = t[6] = 0;
+                t[1] = setup(build_dbl, &model, little);
+            }
+            printf("%-26s", model.name);
+            for (int i = 0; i < 7; i++) {
+                if (t[i] < 0) {
+                    fputs("\nout of memory -- aborting\n", stderr);
+                    oom = 1;
+                    break;
+                }
+                total += t[i];
+                if (t[i] == 0)
+                    printf(" %8s", "-");
+                else
+                    printf(" %8.2f", t[i]);
+            }
+            if (oom)
+                break;
+            putchar('\n');
+            fflush(stdout);
+        }
+        else if (ret == 0 && model.width <= WORDBITS && split) {
+            process_model(&model);
+            if (crc_table_wordwise(&model, little, WORDBITS, WORDCHARS)) {
+                fputs("out of memory -- aborting\n", stderr);
+                oom = 1;
+                break;
+            }
+            printf("%-26s %8.2f %8.2f %8.2f\n", model.name,
+                   speed_frag(crc_wordwise, &model, data),
+                   speed_frag(NULL, &model, data),
+                   speed(crc_wordwise, &model, data, LEN));
+            fflush(stdout);
+        }
+        else if (ret == 0 && model.width <= WORDBITS && batch) {
+            process_model(&model);
+            if (crc_table_wordwise(&model, little, WORDBITS, WORDCHARS)) {
+                fputs("out of memory -- aborting\n", stderr);
+                oom = 1;
+                break;
+            }
+            printf("%-26s %8.2f %8.2f\n", model.name,
+                   speed_batch(&model, 0), speed_batch(&model, 1));
+            fflush(stdout);
+        }
+        else if (ret == 0 && model.width <= WORDBITS && copy) {
+            process_model(&model);
+            if (crc_table_wordwise(&model, little, WORDBITS, WORDCHARS)) {
+                fputs("out of memory -- aborting\n", stderr);
+                oom = 1;
+                break;
+            }
+            printf("%-26s %8.2f %8.2f %8.2f %8.2f\n", model.name,
+                   speed_copy(&model, to, data, LEN, 0),
+                   speed_copy(&model, to, data, LEN, 1),
+                   speed_copy(&model, to, from, COPY_LEN, 0),
+                   speed_copy(&model, to, from, COPY_LEN, 1));
+            fflush(stdout);
+        }
+        else if (ret == 0 && model.width <= WORDBITS && curve) {
+            process_model(&model);
+            printf("%-26s", model.name);
+            for (unsigned n = WORDCHARS; n <= 64; n <<= 1) {
+                if (crc_table_wordwise(&model, little, WORDBITS, n)) {
+                    fputs("\nout of memory -- aborting\n", stderr);
+                    oom = 1;
+                    break;
+                }
+                printf(" %8.2f", speed(crc_wordwise, &model, data, LEN));
+            }
+            if (oom)
+                break;
+            printf("  x%u\n", model.table_bytes);
+            fflush(stdout);
+        }
+        else if (ret == 0 && model.width <= WORDBITS) {
+            process_model(&model);
+            if (crc_table_fast(&model)) {
+                fputs("out of memory -- aborting\n", stderr);
+                oom = 1;
+                break;
+            }
+            crc_table_braid(&model, little);
+            crc_table_clmul(&model);
+            crc_table_hardware(&model);
+            printf("%-26s %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f\n",
+                   model.name,
+                   speed(crc_bytewise, &model, data, LEN),
+                   speed(crc_wordwise, &model, data, LEN),
+                   speed(crc_braid, &model, data, LEN),
+                   speed(crc_clmul, &model, data, LEN),
+                   speed(crc_clmul512, &model, data, LEN),
+                   speed(crc_hardware, &model, data, LEN),
+                   speed(crc_fast, &model, data, LEN));
+            fflush(stdout);
+        }
+        else if (ret == 0 && !curve && !split && !copy &&
+                 !batch) {
+            process_model(&model);
+            if (crc_table_dbl(&model)) {
+                fputs("out of memory -- aborting\n", stderr);
+                oom = 1;
+                break;
+            }
+            printf("%-26s %8.2f %8.2f %8s %8s %8s %8s %8s  (bit %.2f)\n",
+                   model.name,
+                   speed_dbl(crc_bytewise_dbl, &model, data, LEN),
+                   speed_dbl(crc_wordwise_dbl, &model, data, LEN),
+                   "-", "-", "-", "-", "-",
+                   speed_dbl(crc_bitwise_dbl, &model, data, LEN));
+            fflush(stdout);
+        }
+        free_model(&model);
+    }
+    if (init && !oom)
+        printf("%-26s %8.2f  (us, all of the above)\n", "total", total);
+    free(line);
+    free(to);
+    free(from);
+    free(data);
+    crc_shared_free();
+    return oom;
+}
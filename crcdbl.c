@@ -3,9 +3,26 @@
  * For conditions of distribution and use, see copyright notice in crcany.c.
  */
 
+#include <stdlib.h>
 #include "crcdbl.h"
 #include "crc.h"
 
+/* Use the compiler's unsigned 128-bit integer type, if there is one and it is
+   exactly two word_t's, for the table-driven calculation of long CRCs. */
+#if defined(__SIZEOF_INT128__) && WORDCHARS == 8
+#  define DBL128
+__extension__ typedef unsigned __int128 dbl_t;
+
+/* Number of bits in a dbl_t. */
+#  define DBLBITS (WORDBITS << 1)
+
+/* Return the double-word table entry at t as a dbl_t. */
+static inline dbl_t dbl_entry(word_t const *t)
+{
+    return ((dbl_t)t[1] << WORDBITS) | t[0];
+}
+#endif
+
 /* Shift left a double-word quantity by n bits: a <<= n, 0 <= n < WORDBITS.  ah
    and al must be word_t lvalues.  WORDBITS is the number of bits in a word_t,
    which must be an unsigned integer type. */
@@ -184,3 +201,291 @@ void crc_zeros_dbl(model_t *model, word_t *crc_hi, word_t *crc_lo,
     *crc_lo = lo;
     *crc_hi = hi;
 }
+
+#ifdef DBL128
+
+/* Return the CRC in *crc_hi, *crc_lo for a long CRC model as a dbl_t with the
+   xorout value removed, and reversed if the model reverses its output. */
+static dbl_t dbl_pre(model_t *model, word_t crc_hi, word_t crc_lo)
+{
+    word_t lo = crc_lo ^ model->xorout;
+    word_t hi = crc_hi ^ model->xorout_hi;
+
+    if (model->rev)
+        reverse_dbl(&hi, &lo, model->width);
+    hi &= ONES(model->width - WORDBITS);
+    return ((dbl_t)hi << WORDBITS) | lo;
+}
+
+/* Undo dbl_pre() on crc, saving the result in *crc_hi, *crc_lo. */
+static void dbl_post(model_t *model, dbl_t crc, word_t *crc_hi,
+                     word_t *crc_lo)
+{
+    word_t lo = (word_t)crc;
+    word_t hi = (word_t)(crc >> WORDBITS);
+
+    if (model->rev)
+        reverse_dbl(&hi, &lo, model->width);
+    *crc_lo = lo ^ model->xorout;
+    *crc_hi = hi ^ model->xorout_hi;
+}
+
+#endif
+
+int crc_table_dbl(model_t *model)
+{
+#ifdef DBL128
+    word_t (*table)[256][2];
+    dbl_t poly, crc;
+    unsigned k, n, i;
+#endif
+
+    /* build the usual tables for CRCs that fit in a word_t */
+    if (model->width <= WORDBITS) {
+        unsigned little = 1;
+        little = *((unsigned char *)(&little));
+        return crc_table_wordwise(model, little, WORDBITS, WORDCHARS);
+    }
+
+#ifdef DBL128
+    table = realloc(model->table_dbl, 2 * WORDCHARS * sizeof(*table));
+    if (table == NULL)
+        return 2;
+    model->table_dbl = table;
+
+    /* a non-reflected CRC is kept in the top bits of a dbl_t */
+    poly = ((dbl_t)model->poly_hi << WORDBITS) | model->poly;
+    if (!model->ref)
+        poly <<= DBLBITS - model->width;
+
+    /* byte-wise table */
+    for (k = 0; k < 256; k++) {
+        if (model->ref) {
+            crc = k;
+            for (i = 0; i < 8; i++)
+                crc = crc & 1 ? (crc >> 1) ^ poly : crc >> 1;
+        }
+        else {
+            crc = (dbl_t)k << (DBLBITS - 8);
+            for (i = 0; i < 8; i++)
+                crc = crc >> (DBLBITS - 1) ? (crc << 1) ^ poly : crc << 1;
+        }
+        table[0][k][0] = (word_t)crc;
+        table[0][k][1] = (word_t)(crc >> WORDBITS);
+    }
+
+    /* each further table appends a zero byte to the previous one */
+    for (k = 0; k < 256; k++) {
+        crc = dbl_entry(table[0][k]);
+        for (n = 1; n < 2 * WORDCHARS; n++) {
+            crc = model->ref ?
+                (crc >> 8) ^ dbl_entry(table[0][crc & 0xff]) :
+                (crc << 8) ^ dbl_entry(table[0][crc >> (DBLBITS - 8)]);
+            table[n][k][0] = (word_t)crc;
+            table[n][k][1] = (word_t)(crc >> WORDBITS);
+        }
+    }
+#endif
+    return 0;
+}
+
+void crc_bytewise_dbl(model_t *model, word_t *crc_hi, word_t *crc_lo,
+                      unsigned char const *buf, size_t len)
+{
+#ifdef DBL128
+    dbl_t crc;
+#endif
+
+    /* use crc_bytewise() for CRCs that fit in a word_t */
+    if (model->width <= WORDBITS) {
+        *crc_lo = crc_bytewise(model, *crc_lo, buf, len);
+        *crc_hi = 0;
+        return;
+    }
+
+#ifdef DBL128
+    /* if requested, return the initial CRC */
+    if (buf == NULL) {
+        *crc_lo = model->init;
+        *crc_hi = model->init_hi;
+        return;
+    }
+
+    /* process the input data a byte at a time */
+    word_t (*table)[2] = model->table_dbl[0];
+    unsigned shift = DBLBITS - model->width;
+    crc = dbl_pre(model, *crc_hi, *crc_lo);
+    if (model->ref)
+        while (len--)
+            crc = (crc >> 8) ^ dbl_entry(table[(crc ^ *buf++) & 0xff]);
+    else {
+        crc <<= shift;
+        while (len--)
+            crc = (crc << 8) ^
+                  dbl_entry(table[(crc >> (DBLBITS - 8)) ^ *buf++]);
+        crc >>= shift;
+    }
+    dbl_post(model, crc, crc_hi, crc_lo);
+#else
+    crc_bitwise_dbl(model, crc_hi, crc_lo, buf, len);
+#endif
+}
+
+void crc_wordwise_dbl(model_t *model, word_t *crc_hi, word_t *crc_lo,
+                      unsigned char const *buf, size_t len)
+{
+#ifdef DBL128
+    dbl_t crc, next;
+    unsigned k;
+#endif
+
+    /* use crc_wordwise() for CRCs that fit in a word_t */
+    if (model->width <= WORDBITS) {
+        *crc_lo = crc_wordwise(model, *crc_lo, buf, len);
+        *crc_hi = 0;
+        return;
+    }
+
+#ifdef DBL128
+    /* if requested, return the initial CRC */
+    if (buf == NULL) {
+        *crc_lo = model->init;
+        *crc_hi = model->init_hi;
+        return;
+    }
+
+    /* process sixteen bytes at a time -- each byte of the CRC register is
+       exclusive-ored with the input byte that it meets, and the result is
+       looked up in the table for the number of bytes that follow it */
+    word_t (*table)[256][2] = model->table_dbl;
+    unsigned shift = DBLBITS - model->width;
+    crc = dbl_pre(model, *crc_hi, *crc_lo);
+    if (model->ref) {
+        while (len >= 2 * WORDCHARS) {
+            next = 0;
+            for (k = 0; k < 2 * WORDCHARS; k++)
+                next ^= dbl_entry(table[2 * WORDCHARS - 1 - k]
+                                       [((crc >> (k << 3)) ^ buf[k]) & 0xff]);
+            crc = next;
+            buf += 2 * WORDCHARS;
+            len -= 2 * WORDCHARS;
+        }
+        while (len--)
+            crc = (crc >> 8) ^ dbl_entry(table[0][(crc ^ *buf++) & 0xff]);
+    }
+    else {
+        crc <<= shift;
+        while (len >= 2 * WORDCHARS) {
+            next = 0;
+            for (k = 0; k < 2 * WORDCHARS; k++)
+                next ^= dbl_entry(table[2 * WORDCHARS - 1 - k]
+                                       [((crc >> (DBLBITS - 8 - (k << 3))) ^
+                                         buf[k]) & 0xff]);
+            crc = next;
+            buf += 2 * WORDCHARS;
+            len -= 2 * WORDCHARS;
+        }
+        while (len--)
+            crc = (crc << 8) ^
+                  dbl_entry(table[0][(crc >> (DBLBITS - 8)) ^ *buf++]);
+        crc >>= shift;
+    }
+    dbl_post(model, crc, crc_hi, crc_lo);
+#else
+    crc_bitwise_dbl(model, crc_hi, crc_lo, buf, len);
+#endif
+}
+
+/* Set *prod_hi, *prod_lo to a(x) times b(x) modulo p(x), where p(x) is the
+   CRC polynomial of the long CRC model, and the polynomials are in the same
+   form as the CRC register.  This is done a bit at a time, using the same
+   steps as crc_zeros_dbl() to multiply b(x) by x. */
+static void multmodp_dbl(model_t *model, word_t a_hi, word_t a_lo,
+                         word_t hi, word_t lo, word_t *prod_hi,
+                         word_t *prod_lo)
+{
+    word_t poly_lo = model->poly;
+    word_t poly_hi = model->poly_hi;
+    word_t p_hi = 0, p_lo = 0;
+
+    if (model->ref) {
+        /* the top bit of a is x^0 */
+        word_t top = (word_t)1 << (model->width - WORDBITS - 1);
+        while (a_hi | a_lo) {
+            if (a_hi & top) {
+                p_hi ^= hi;
+                p_lo ^= lo;
+            }
+            SHL(a_hi, a_lo, 1);
+            a_hi &= ONES(model->width - WORDBITS);
+            BIGREF;
+        }
+    }
+    else {
+        /* the bottom bit of a is x^0 */
+        word_t mask = (word_t)1 << (model->width - WORDBITS - 1);
+        while (a_hi | a_lo) {
+            if (a_lo & 1) {
+                p_hi ^= hi;
+                p_lo ^= lo;
+            }
+            SHR(a_hi, a_lo, 1);
+            BIGNORM;
+        }
+        p_hi &= ONES(model->width - WORDBITS);
+    }
+    *prod_hi = p_hi;
+    *prod_lo = p_lo;
+}
+
+void crc_zeros_dbl_fast(model_t *model, word_t *crc_hi, word_t *crc_lo,
+                        uintmax_t count)
+{
+    word_t lo, hi, xp_hi, xp_lo, sq_hi, sq_lo;
+
+    /* use crc_zeros_fast() for CRCs that fit in a word_t */
+    if (model->width <= WORDBITS) {
+        *crc_lo = crc_zeros_fast(model, *crc_lo, count);
+        *crc_hi = 0;
+        return;
+    }
+
+    /* pre-process the CRC */
+    lo = *crc_lo ^ model->xorout;
+    hi = *crc_hi ^ model->xorout_hi;
+    if (model->rev)
+        reverse_dbl(&hi, &lo, model->width);
+    hi &= ONES(model->width - WORDBITS);
+
+    /* compute x^count modulo p(x) by repeated squaring, starting with x^0 in
+       xp and x^1 in sq */
+    if (model->ref) {
+        xp_hi = (word_t)1 << (model->width - WORDBITS - 1);
+        xp_lo = 0;
+        sq_hi = xp_hi >> 1;
+        sq_lo = sq_hi ? 0 : (word_t)1 << (WORDBITS - 1);
+    }
+    else {
+        xp_hi = sq_hi = 0;
+        xp_lo = 1;
+        sq_lo = 2;
+    }
+    while (count) {
+        if (count & 1)
+            multmodp_dbl(model, sq_hi, sq_lo, xp_hi, xp_lo, &xp_hi, &xp_lo);
+        count >>= 1;
+        if (count)
+            multmodp_dbl(model, sq_hi, sq_lo, sq_hi, sq_lo, &sq_hi, &sq_lo);
+    }
+
+    /* multiply the CRC by x^count */
+    multmodp_dbl(model, xp_hi, xp_lo, hi, lo, &hi, &lo);
+
+    /* post-process and return the CRC */
+    if (model->rev)
+        reverse_dbl(&hi, &lo, model->width);
+    lo ^= model->xorout;
+    hi ^= model->xorout_hi;
+    *crc_lo = lo;
+    *crc_hi = hi;
+}
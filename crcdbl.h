@@ -30,8 +30,42 @@
 void crc_bitwise_dbl(model_t *, word_t *, word_t *,
                      unsigned char const *, size_t);
 
+/* Build the tables for crc_bytewise_dbl() and crc_wordwise_dbl(). For long
+   CRC models, model->table_dbl is allocated or reallocated with 2 * WORDCHARS
+   tables of 256 double-word entries, each entry stored as the low word then
+   the high word. table_dbl[n][k] is the CRC register contents, with the init
+   and xorout values removed, for the byte k followed by n zero bytes. For
+   short CRC models, the byte-wise and word-wise tables are built instead using
+   crc_table_wordwise() for the machine being run on. Return 0 on success, or 2
+   if out of memory.
+
+   If the compiler does not provide an unsigned 128-bit integer type, or if
+   word_t is not 64 bits, then no tables are built for long CRC models, and
+   crc_bytewise_dbl() and crc_wordwise_dbl() use crc_bitwise_dbl() instead. */
+int crc_table_dbl(model_t *);
+
+/* Similar to crc_bitwise_dbl(), but computes the CRC a byte at a time using
+   the tables built by crc_table_dbl(). This calls crc_bytewise() for short CRC
+   models. */
+void crc_bytewise_dbl(model_t *, word_t *, word_t *,
+                      unsigned char const *, size_t);
+
+/* Similar to crc_bitwise_dbl(), but computes the CRC sixteen bytes at a time
+   using the tables built by crc_table_dbl(). This calls crc_wordwise() for
+   short CRC models. */
+void crc_wordwise_dbl(model_t *, word_t *, word_t *,
+                      unsigned char const *, size_t);
+
 /* Similar to crc_zeros(), but works for CRCs up to twice as long as a
    word_t. */
 void crc_zeros_dbl(model_t *, word_t *, word_t *, size_t);
 
+/* Similar to crc_zeros_fast(), but works for CRCs up to twice as long as a
+   word_t. For long CRC models, x raised to the count power modulo the CRC
+   polynomial is computed by repeated squaring and then multiplied by the CRC,
+   taking time proportional to the logarithm of the count, with no tables
+   needed. For short CRC models this calls crc_zeros_fast(), which needs the
+   tables from crc_table_combine(). */
+void crc_zeros_dbl_fast(model_t *, word_t *, word_t *, uintmax_t);
+
 #endif
@@ -4,6 +4,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
 #include "crc.h"
@@ -18,6 +19,11 @@
 // Mask value below which to print in decimal in generated code.
 #define DEC 10
 
+// Number of lanes for the generated braided routine, when not specified, for
+// 64-bit and 32-bit words.
+#define BRAIDS_64 5
+#define BRAIDS_32 6
+
 // See crcgen.h.
 int rev_gen(int bits, FILE *src) {
     // Check for a valid argument.
@@ -123,14 +129,256 @@ int rev_gen(int bits, FILE *src) {
     return 0;
 }
 
+// Generate the exclusive-or of the table lookups for one step of the sliced
+// word-wise loop, which processes slices bytes of data, word_bytes at a time,
+// for the endianess little. The first word has the CRC in it and is in the
+// variable word. The rest are w[1], w[2], and so on. The byte at offset p in
+// the slice uses table slices - 1 - p of the tables named table. The result is
+// assigned to var, with the statement indented by indent spaces.
+static void slice_gen(FILE *code, unsigned little, unsigned word_bytes,
+                      unsigned slices, char const *table, char const *word,
+                      char const *var, int indent) {
+    unsigned per = slices / word_bytes;
+    fprintf(code,
+        "%*s%s = ", indent, "", var);
+    for (unsigned n = 0; n < per; n++)
+        for (unsigned k = 0; k < word_bytes; k++) {
+            // k is the byte of the word in significance, which is at
+            // offset k in memory for little-endian, or word_bytes - 1 - k
+            // for big-endian
+            unsigned p = n * word_bytes + (little ? k : word_bytes - 1 - k);
+            char src[16];
+            if (n)
+                sprintf(src, "w[%u]", n);
+            else
+                strcpy(src, word);
+            if (n || k)
+                fprintf(code,
+        " ^\n"
+        "%*s", indent + (int)strlen(var) + 3, "");
+            if (k == 0)
+                fprintf(code, "%s[%u][%s & 0xff]",
+                        table, slices - 1 - p, src);
+            else if (k == word_bytes - 1)
+                fprintf(code, "%s[%u][%s >> %u]",
+                        table, slices - 1 - p, src, k << 3);
+            else
+                fprintf(code, "%s[%u][(%s >> %u) & 0xff]",
+                        table, slices - 1 - p, src, k << 3);
+        }
+    fputs(";\n", code);
+}
+
+// Generate the exclusive-or of crc with xorout, at the start of a routine if
+// first is true, or else at the end, when the bits of crc above the CRC have
+// been cleared and must stay that way.
+static void xorout_gen(FILE *code, model_t *model, unsigned crc_bits,
+                       int first) {
+    if (model->xorout == 0)
+        return;
+    if (model->xorout == ONES(model->width) &&
+        (first || crc_bits == model->width))
+        fputs(
+        "    crc = ~crc;\n", code);
+    else
+        fprintf(code,
+        "    crc ^= %#"X";\n", model->xorout);
+}
+
+// Write the declaration decl of a table to code, initialized with the rows
+// rows of cols entries in ent[], each row in braces. If rows is zero, then
+// there is one row of cols entries with no braces.
+static void table_gen(FILE *code, char const *decl, word_t const *ent,
+                      unsigned rows, unsigned cols) {
+    unsigned count = (rows ? rows : 1) * cols;
+    word_t most = 0;
+    for (unsigned i = 0; i < count; i++)
+        if (ent[i] > most)
+            most = ent[i];
+    int hex = most > 9;
+    int digits = 0;
+    while (most) {
+        most >>= 4;
+        digits++;
+    }
+    fprintf(code,
+        "\n"
+        "%s = {\n", decl);
+    char const *pre = "   ";            // this plus one space is line prefix
+    unsigned const max = COLS;          // maximum length before new line
+    unsigned n = 0;                     // characters on this line, so far
+    for (unsigned i = 0; i < count; i++) {
+        unsigned k = i % cols;
+        if (n == 0)
+            n += fprintf(code, "%s", pre);
+        n += fprintf(code, "%s%s%0*"X"%s",
+                     k || !rows ? " " : "{", hex ? "0x" : "", digits, ent[i],
+                     k != cols - 1 ? "," :
+                     !rows ? "" : i != count - 1 ? "}," : "}");
+        if (n + digits + (hex ? 5 : 3) > max || (rows && k == cols - 1)) {
+            putc('\n', code);
+            n = 0;
+        }
+    }
+    if (n)
+        putc('\n', code);
+    fputs(
+        "};\n", code);
+}
+
+// Write the tables used by the generated code for model to code, each with
+// the declaration storage (e.g. "static "), and the name prefix followed by
+// byte, word, braid, or pow. If head is not NULL, then extern declarations
+// for them are written to head. The entries have no initial or final
+// exclusive-or, so that the tables depend only on the width, polynomial, and
+// reflection of the CRC, and the layout arguments. table_byte[] is not
+// written if alias is true, since it is the same as the first word-wise
+// table. ent[] is space for 64 tables of 256 entries. table_pow[i][k] is
+// x^(8 k 16^i) modulo p(x), so that the power of x for any length can be had
+// with one multiplication per hexadecimal digit of the length.
+static void tables_gen(FILE *head, FILE *code, model_t *model,
+                       char const *storage, char const *prefix,
+                       unsigned little, unsigned word_bits, unsigned slices,
+                       unsigned braids, char const *crc_type,
+                       char const *word_type, int alias, word_t *ent) {
+    unsigned word_bytes = word_bits >> 3;
+    char const *wide = little ? crc_type : word_type;
+    char decl[96];
+
+    // byte-wise table
+    if (!alias) {
+        for (unsigned k = 0; k < 256; k++)
+            ent[k] = model->table_byte[k] ^ model->table_byte[0];
+        sprintf(decl, "%s%s const %sbyte[]", storage, crc_type, prefix);
+        table_gen(code, decl, ent, 0, 256);
+        if (head != NULL)
+            fprintf(head, "extern %s const %sbyte[];\n", crc_type, prefix);
+    }
+
+    // word-wise tables
+    for (unsigned j = 0; j < slices; j++)
+        for (unsigned k = 0; k < 256; k++)
+            ent[(j << 8) + k] = crc_table_word(model, j, k) ^
+                                crc_table_word(model, j, 0);
+    sprintf(decl, "%s%s const %sword[][256]", storage, wide, prefix);
+    table_gen(code, decl, ent, slices, 256);
+    if (head != NULL)
+        fprintf(head, "extern %s const %sword[][256];\n", wide, prefix);
+
+    // braid tables, which are the word-wise tables for the bytes of one word
+    // followed by the other braids - 1 words
+    if (braids) {
+        unsigned off = (braids - 1) * word_bytes;
+        for (unsigned j = 0; j < word_bytes; j++)
+            for (unsigned k = 0; k < 256; k++)
+                ent[(j << 8) + k] = crc_table_word(model, off + j, k) ^
+                                    crc_table_word(model, off + j, 0);
+        sprintf(decl, "%s%s const %sbraid[][256]", storage, wide, prefix);
+        table_gen(code, decl, ent, word_bytes, 256);
+        if (head != NULL)
+            fprintf(head, "extern %s const %sbraid[][256];\n", wide, prefix);
+    }
+
+    // powers of x for combination and shifting
+    for (unsigned i = 0; i < WORDBITS / 4; i++)
+        for (unsigned k = 0; k < 16; k++)
+            ent[(i << 4) + k] = model->table_pow[i][k];
+    sprintf(decl, "%s%s const %spow[][16]", storage, crc_type, prefix);
+    table_gen(code, decl, ent, WORDBITS / 4, 16);
+    if (head != NULL)
+        fprintf(head, "extern %s const %spow[][16];\n", crc_type, prefix);
+}
+
+// A set of tables written to a shared table section.
+typedef struct set_s {
+    word_t poly;                // polynomial
+    unsigned short width;       // CRC width in bits
+    char ref;                   // true if reflected
+    struct set_s *next;         // next set in the list
+} set_t;
+
+// A shared table section.
+struct share_s {
+    char *name;                 // base name of the section's source files
+    FILE *head, *code;          // the section's header and code
+    int used;                   // true once the layout has been set
+    unsigned little, word_bits, slices, braids;     // layout of all the sets
+    set_t *set;                 // list of sets written so far
+};
+
+// See crcgen.h.
+share_t *share_new(char *name, FILE *head, FILE *code) {
+    share_t *share = malloc(sizeof(share_t));
+    if (share == NULL)
+        return NULL;
+    share->name = malloc(strlen(name) + 1);
+    if (share->name == NULL) {
+        free(share);
+        return NULL;
+    }
+    strcpy(share->name, name);
+    share->head = head;
+    share->code = code;
+    share->used = 0;
+    share->set = NULL;
+    fputs(
+        "// Tables shared by the generated CRC code, with no initial or final\n"
+        "// exclusive-or. Each set is for one CRC width, polynomial, and\n"
+        "// reflection, named crc_<width>_<polynomial>_<r or n>_.\n"
+        "\n"
+        "#include <stdint.h>\n", head);
+    fprintf(code,
+        "#include \"%s.h\"\n", name);
+    return share;
+}
+
+// See crcgen.h.
+void share_free(share_t *share) {
+    if (share == NULL)
+        return;
+    set_t *set = share->set;
+    while (set != NULL) {
+        set_t *next = set->next;
+        free(set);
+        set = next;
+    }
+    free(share->name);
+    free(share);
+}
+
 // See crcgen.h.
 int crc_gen(model_t *model, char *name,
-                   unsigned little, unsigned word_bits,
-                   FILE *head, FILE *code) {
+                   unsigned little, unsigned word_bits, unsigned slices,
+                   unsigned braids, share_t *share, FILE *head, FILE *code) {
     // check input -- if invalid, do nothing
-    if ((word_bits != 32 && word_bits != 64) || model->width > word_bits)
+    if (slices == 0)
+        slices = word_bits >> 3;
+    if (braids == 1)
+        braids = word_bits == 64 ? BRAIDS_64 : BRAIDS_32;
+    if ((word_bits != 32 && word_bits != 64) || model->width > word_bits ||
+        slices % (word_bits >> 3) || slices > 64 ||
+        braids * (word_bits >> 3) > 64)
+        return 1;
+    if (share != NULL && share->used &&
+        (little != share->little || word_bits != share->word_bits ||
+         slices != share->slices || braids != share->braids))
         return 1;
 
+    // generate byte-wise, word-wise, and combination tables, before writing
+    // anything -- the braid tables are the word-wise tables for the bytes of
+    // one word followed by the other braids - 1 words, so enough word-wise
+    // tables are made to cover those
+    unsigned most = braids * (word_bits >> 3);
+    if (crc_table_bytewise(model) ||
+        crc_table_wordwise(model, little, word_bits,
+                           slices > most ? slices : most) ||
+        crc_table_combine(model))
+        return 2;
+    crc_table_clmul(model);
+    word_t *ent = malloc(64 * 256 * sizeof(word_t));
+    if (ent == NULL)
+        return 2;
+
     // select the unsigned integer type to be used for CRC calculations
     char *crc_type;
     unsigned crc_bits;
@@ -160,24 +408,102 @@ int crc_gen(model_t *model, char *name,
     for (unsigned n = word_bytes; n > 1; n >>= 1)
         word_shift++;
 
+    // number of words processed at each step of the sliced loop, if more than
+    // one, and the size of the word-wise tables in bytes
+    unsigned per = slices / word_bytes;
+    unsigned long table_size = slices * 256UL *
+        (little ? crc_bits >> 3 : word_bytes);
+
     // provide usage information in the header, and define the integer types
     fprintf(head,
-        "// The _bit, _byte, and _word routines return the CRC of the len bytes at mem,\n"
-        "// applied to the previous CRC value, crc. If mem is NULL, then the other\n"
-        "// arguments are ignored, and the initial CRC, i.e. the CRC of zero bytes, is\n"
-        "// returned. Those routines will all return the same result, differing only in\n"
-        "// speed and code complexity. The _rem routine returns the CRC of the remaining\n"
-        "// bits in the last byte, for when the number of bits in the message is not a\n"
-        "// multiple of eight. The %s bits bits of the low byte of val are applied to\n"
-        "// crc. bits must be in 0..8.\n"
+        "// The _bit, _byte, _word, and _clmul routines return the CRC of the len\n"
+        "// bytes at mem, applied to the previous CRC value, crc. If mem is NULL, then\n"
+        "// the other arguments are ignored, and the initial CRC, i.e. the CRC of zero\n"
+        "// bytes, is returned. Those routines will all return the same result,\n"
+        "// differing only in speed and code complexity. The _rem routine returns the\n"
+        "// CRC of the remaining bits in the last byte, for when the number of bits in\n"
+        "// the message is not a multiple of eight. The %s bits bits of the low byte\n"
+        "// of val are applied to crc. bits must be in 0..8.\n"
+        "\n"
+        "// The _word routine processes %u bytes at each step, using %u tables of 256\n"
+        "// entries, for %lu bytes of tables.\n", model->ref ? "low" : "high",
+            slices, slices, table_size);
+    if (braids)
+        fprintf(head,
+        "// The _braid routine runs %u independent CRCs on interleaved words, using\n"
+        "// %u more tables of 256 entries, and merges them at the end.\n",
+            braids, word_bytes);
+    fputs(
         "\n"
         "#include <stddef.h>\n"
-        "#include <stdint.h>\n", model->ref ? "low" : "high");
+        "#include <stdint.h>\n", head);
 
     // include the header in the code
     fprintf(code,
         "#include \"%s.h\"\n", name);
 
+    // tables, written once for each set to the shared table section if there
+    // is one, which is included and the tables referred to by their usual
+    // names, or else written to the code as static tables -- if the byte-wise
+    // table is the same as the first word-wise table, then it is not written
+    int alias = (little && (model->ref || model->width <= 8)) ||
+                (!little && !model->ref && model->width == word_bits);
+    if (share == NULL)
+        tables_gen(NULL, code, model, "static ", "table_", little, word_bits,
+                   slices, braids, crc_type, word_type, alias, ent);
+    else {
+        char prefix[40];
+        sprintf(prefix, "crc_%u_%"X"_%c_", model->width, model->poly,
+                model->ref ? 'r' : 'n');
+        set_t *set = share->set;
+        while (set != NULL && (set->width != model->width ||
+                               set->poly != model->poly ||
+                               set->ref != model->ref))
+            set = set->next;
+        if (set == NULL) {
+            set = malloc(sizeof(set_t));
+            if (set == NULL) {
+                free(ent);
+                return 2;
+            }
+            set->width = model->width;
+            set->poly = model->poly;
+            set->ref = model->ref;
+            set->next = share->set;
+            share->set = set;
+            share->used = 1;
+            share->little = little;
+            share->word_bits = word_bits;
+            share->slices = slices;
+            share->braids = braids;
+            fprintf(share->head,
+                "\n"
+                "// %u-bit CRC with polynomial %#"X", %sreflected.\n",
+                    model->width, model->poly, model->ref ? "" : "not ");
+            tables_gen(share->head, share->code, model, "", prefix, little,
+                       word_bits, slices, braids, crc_type, word_type, alias,
+                       ent);
+        }
+        fprintf(code,
+        "#include \"%s.h\"\n"
+        "\n", share->name);
+        if (!alias)
+            fprintf(code,
+        "#define table_byte %sbyte\n", prefix);
+        fprintf(code,
+        "#define table_word %sword\n", prefix);
+        if (braids)
+            fprintf(code,
+        "#define table_braid %sbraid\n", prefix);
+        fprintf(code,
+        "#define table_pow %spow\n", prefix);
+    }
+    free(ent);
+    if (alias)
+        fputs(
+        "\n"
+        "#define table_byte table_word[0]\n", code);
+
     // function to reverse the low model->width bits, if needed (unlikely)
     if (model->rev)
         rev_gen(model->width, code);
@@ -382,90 +708,6 @@ int crc_gen(model_t *model, char *name,
         "    return crc;\n"
         "}\n", code);
 
-    // generate byte-wise and word-wise tables
-    crc_table_wordwise(model, little, word_bits);
-
-    // byte-wise table
-    if ((little && (model->ref || model->width <= 8)) ||
-        (!little && !model->ref && model->width == word_bits))
-        fputs(
-        "\n"
-        "#define table_byte table_word[0]\n", code);
-    else {
-        fprintf(code,
-        "\n"
-        "static %s const table_byte[] = {\n", crc_type);
-        {
-            word_t most = 0;
-            for (unsigned k = 0; k < 256; k++)
-                if (model->table_byte[k] > most)
-                    most = model->table_byte[k];
-            int hex = most > 9;
-            int digits = 0;
-            while (most) {
-                most >>= 4;
-                digits++;
-            }
-            char const *pre = "   ";    // this plus one space is line prefix
-            unsigned const max = COLS;  // maximum length before new line
-            unsigned n = 0;             // characters on this line, so far
-            for (unsigned k = 0; k < 255; k++) {
-                if (n == 0)
-                    n += fprintf(code, "%s", pre);
-                n += fprintf(code, " %s%0*"X",",
-                             hex ? "0x" : "", digits, model->table_byte[k]);
-                if (n + digits + (hex ? 4 : 2) > max) {
-                    putc('\n', code);
-                    n = 0;
-                }
-            }
-            fprintf(code, "%s %s%0*"X, n ? "" : pre,
-                    hex ? "0x" : "", digits, model->table_byte[255]);
-        }
-        fputs(
-        "\n"
-        "};\n", code);
-    }
-
-    // word-wise table
-    fprintf(code,
-        "\n"
-        "static %s const table_word[][256] = {\n",
-            little ? crc_type : word_type);
-    {
-        word_t most = 0;
-        for (unsigned j = 0; j < word_bytes; j++)
-            for (unsigned k = 0; k < 256; k++)
-                if (model->table_word[j][k] > most)
-                    most = model->table_word[j][k];
-        int hex = most > 9;
-        int digits = 0;
-        while (most) {
-            most >>= 4;
-            digits++;
-        }
-        char const *pre = "   ";        // this plus one space is line prefix
-        unsigned const max = COLS;      // maximum length before new line
-        unsigned n = 0;                 // characters on this line, so far
-        for (unsigned j = 0; j < word_bytes; j++) {
-            for (unsigned k = 0; k < 256; k++) {
-                if (n == 0)
-                    n += fprintf(code, "%s", pre);
-                n += fprintf(code, "%s%s%0*"X"%s",
-                             k ? " " : "{", hex ? "0x" : "", digits,
-                             model->table_word[j][k],
-                             k != 255 ? "," :
-                                        j != word_bytes - 1 ? "}," : "}");
-                if (n + digits + (hex ? 5 : 3) > max || k == 255) {
-                    putc('\n', code);
-                    n = 0;
-                }
-            }
-        }
-    }
-    fputs(
-        "};\n", code);
-
     // byte-wise CRC calculation function
     fprintf(head,
         "\n"
@@ -478,6 +720,7 @@ int crc_gen(model_t *model, char *name,
         "    unsigned char const *data = mem;\n"
         "    if (data == NULL)\n"
         "        return %#"X";\n", crc_type, name, crc_type, model->init);
+    xorout_gen(code, model, crc_bits, 1);
     if (model->rev)
         fprintf(code,
         "    crc = revlow%d(crc);\n", model->width);
@@ -523,6 +766,7 @@ int crc_gen(model_t *model, char *name,
     if (model->rev)
         fprintf(code,
         "    crc = revlow%d(crc);\n", model->width);
+    xorout_gen(code, model, crc_bits, 0);
     fputs(
         "    return crc;\n"
         "}\n", code);
@@ -578,6 +822,7 @@ int crc_gen(model_t *model, char *name,
         "    if (data == NULL)\n"
         "        return %#"X";\n",
             little ? "little" : "big", crc_type, name, crc_type, model->init);
+    xorout_gen(code, model, crc_bits, 1);
     if (model->rev)
         fprintf(code,
         "    crc = revlow%d(crc);\n", model->width);
@@ -631,6 +876,20 @@ int crc_gen(model_t *model, char *name,
                 fputs(
                       "    crc = swaplow(crc);\n", code);
         }
+        if (per > 1) {
+            fprintf(code,
+        "    size_t m = len / %u;\n"
+        "    for (size_t i = 0; i < m; i++) {\n"
+        "        %s const *w = (%s const *)data + i * %u;\n"
+        "        %s word = crc ^ w[0];\n",
+                slices, word_type, word_type, per, word_type);
+            slice_gen(code, little, word_bytes, slices, "table_word", "word",
+                      "crc", 8);
+            fprintf(code,
+        "    }\n"
+        "    data += m * %u;\n"
+        "    len -= m * %u;\n", slices, slices);
+        }
         fprintf(code,
         "    size_t n = len >> %u;\n"
         "    for (size_t i = 0; i < n; i++) {\n"
@@ -668,6 +927,20 @@ int crc_gen(model_t *model, char *name,
         else
             fprintf(code,
         "    %s word = (%s)crc << %u;\n", word_type, word_type, top);
+        if (per > 1) {
+            fprintf(code,
+        "    size_t m = len / %u;\n"
+        "    for (size_t i = 0; i < m; i++) {\n"
+        "        %s const *w = (%s const *)data + i * %u;\n"
+        "        word ^= w[0];\n",
+                slices, word_type, word_type, per);
+            slice_gen(code, little, word_bytes, slices, "table_word", "word",
+                      "word", 8);
+            fprintf(code,
+        "    }\n"
+        "    data += m * %u;\n"
+        "    len -= m * %u;\n", slices, slices);
+        }
         fprintf(code,
         "    size_t n = len >> %u;\n"
         "    for (size_t i = 0; i < n; i++) {\n"
@@ -734,55 +1007,178 @@ int crc_gen(model_t *model, char *name,
     if (model->rev)
         fprintf(code,
         "    crc = revlow%d(crc);\n", model->width);
+    xorout_gen(code, model, crc_bits, 0);
     fputs(
         "    return crc;\n"
         "}\n", code);
 
-    // CRC combination table.
-    fprintf(head,
+    // Braided word-wise CRC calculation function. braids independent CRCs
+    // are run on interleaved words, the first starting with the CRC so far and
+    // the rest with zero, which lets the processor work on them in parallel.
+    // The lanes are merged by the word-wise tables while processing the last
+    // block.
+    if (braids) {
+        unsigned block = braids * word_bytes;
+
+        // shift and swap to put the CRC in the form of the word-wise register
+        unsigned top = 0, swap = 0;
+        if (little) {
+            if (!model->ref && model->width > 8) {
+                top = -model->width & 7;
+                swap = (model->width + 7) >> 3;
+            }
+        }
+        else if (model->ref)
+            swap = word_bytes;
+        else
+            top = word_bits - (model->width > 8 ? model->width : 8);
+
+        fprintf(head,
         "\n"
-        "// Compute the combination of two CRCs.\n"
-        "%s %s_comb(%s crc1, %s crc2, uintmax_t len2);\n",
-            crc_type, name, crc_type, crc_type);
-    crc_table_combine(model);
-    fprintf(code,
+        "// Compute the CRC a word at a time, braided over %u lanes.\n"
+        "%s %s_braid(%s crc, void const *mem, size_t len);\n",
+            braids, crc_type, name, crc_type);
+        fprintf(code,
+        "\n"
+        "%s %s_braid(%s crc, void const *mem, size_t len) {\n"
+        "    unsigned char const *data = mem;\n"
+        "    if (data == NULL)\n"
+        "        return %#"X";\n"
+        "    if (len < %u)\n"
+        "        return %s_word(crc, data, len);\n"
+        "\n"
+        "    // do bytes up to word boundary\n"
+        "    size_t pre = -(uintptr_t)data & %#x;\n"
+        "    crc = %s_word(crc, data, pre);\n"
+        "    data += pre;\n"
+        "    len -= pre;\n",
+            crc_type, name, crc_type, model->init,
+            2 * block + word_bytes - 1, name, word_bytes - 1, name);
+        if (model->xorout || model->rev ||
+            (model->width < 8 && !model->ref) || !little || top || swap)
+            fputs(
         "\n"
-        "static %s const table_comb[] = {\n", crc_type);
-    {
-        word_t most = 0;
-        unsigned len = model->cycle < word_bits ? model->cycle : word_bits;
-        for (unsigned k = 0; k < len; k++)
-            if (model->table_comb[k] > most)
-                most = model->table_comb[k];
-        int hex = most > 9;
-        int digits = 0;
-        while (most) {
-            most >>= 4;
-            digits++;
+        "    // put the CRC in the form of the word-wise register\n", code);
+        xorout_gen(code, model, crc_bits, 0);
+        if (model->rev)
+            fprintf(code,
+        "    crc = revlow%d(crc);\n", model->width);
+        if (model->width < 8 && !model->ref)
+            fprintf(code,
+        "    crc <<= %u;\n", shift);
+        char *lane_type = little ? crc_type : word_type;
+        char const *reg = "crc";
+        if (little) {
+            if (top)
+                fprintf(code,
+        "    crc <<= %u;\n", top);
+            if (swap)
+                fputs(
+        "    crc = swaplow(crc);\n", code);
         }
-        char const *pre = "   ";    // this plus one space is line prefix
-        unsigned const max = COLS;  // maximum length before new line
-        unsigned n = 0;             // characters on this line, so far
-        for (unsigned k = 0; k < len - 1; k++) {
-            if (n == 0)
-                n += fprintf(code, "%s", pre);
-            n += fprintf(code, " %s%0*"X",",
-                         hex ? "0x" : "", digits, model->table_comb[k]);
-            if (n + digits + (hex ? 4 : 2) > max) {
-                putc('\n', code);
-                n = 0;
-            }
+        else {
+            if (swap)
+                fprintf(code,
+        "    %s word = swapmax(crc);\n", word_type);
+            else
+                fprintf(code,
+        "    %s word = (%s)crc << %u;\n", word_type, word_type, top);
+            reg = "word";
         }
-        fprintf(code, "%s %s%0*"X, n ? "" : pre,
-                hex ? "0x" : "", digits, model->table_comb[len - 1]);
+
+        // run the lanes over all but the last block
+        fprintf(code,
+        "\n"
+        "    // run %u pure CRCs on interleaved words, leaving out the last "
+                                                                "block\n"
+        "    %s const *w = (%s const *)data;\n"
+        "    size_t blocks = len / %u - 1;\n"
+        "    %s lane0 = %s;\n", braids, word_type, word_type, block,
+            lane_type, reg);
+        for (unsigned n = 1; n < braids; n++)
+            fprintf(code,
+        "    %s lane%u = 0;\n", lane_type, n);
+        fputs(
+        "    for (size_t i = 0; i < blocks; i++) {\n", code);
+        for (unsigned n = 0; n < braids; n++)
+            fprintf(code,
+        "        %s word%u = lane%u ^ w[%u];\n", word_type, n, n, n);
+        for (unsigned n = 0; n < braids; n++) {
+            char word[16], lane[16];
+            sprintf(word, "word%u", n);
+            sprintf(lane, "lane%u", n);
+            slice_gen(code, little, word_bytes, word_bytes, "table_braid",
+                      word, lane, 8);
+        }
+        fprintf(code,
+        "        w += %u;\n"
+        "    }\n"
+        "\n"
+        "    // merge the lanes while processing the last block\n", braids);
+        if (little)
+            fprintf(code,
+        "    %s word;\n", word_type);
+        for (unsigned n = 0; n < braids; n++) {
+            if (n)
+                fprintf(code,
+        "    word = %s ^ lane%u ^ w[%u];\n", reg, n, n);
+            else
+                fputs(
+        "    word = lane0 ^ w[0];\n", code);
+            slice_gen(code, little, word_bytes, word_bytes, "table_word",
+                      "word", reg, 4);
+        }
+        fprintf(code,
+        "    w += %u;\n"
+        "    len -= (unsigned char const *)w - data;\n"
+        "    data = (unsigned char const *)w;\n"
+        "\n"
+        "    // return the CRC to its usual form, and do the rest\n",
+            braids);
+        if (little) {
+            if (swap)
+                fputs(
+        "    crc = swaplow(crc);\n", code);
+            if (top)
+                fprintf(code,
+        "    crc >>= %u;\n", top);
+        }
+        else if (swap)
+            fputs(
+        "    crc = swapmax(word);\n", code);
+        else
+            fprintf(code,
+        "    crc = word >> %u;\n", top);
+        if (model->width < 8 && !model->ref)
+            fprintf(code,
+        "    crc >>= %u;\n", shift);
+        if (model->rev)
+            fprintf(code,
+        "    crc = revlow%d(crc);\n", model->width);
+        xorout_gen(code, model, crc_bits, 0);
+        fprintf(code,
+        "    return %s_word(crc, data, len);\n"
+        "}\n", name);
     }
-    fputs(
+
+    // CRC combination and shift functions.
+    fprintf(head,
         "\n"
-        "};\n", code);
+        "// Compute the combination of two CRCs.\n"
+        "%s %s_comb(%s crc1, %s crc2, uintmax_t len2);\n"
+        "\n"
+        "// Compute the CRC of the message with CRC crc followed by len zero bytes.\n"
+        "%s %s_shift(%s crc, uintmax_t len);\n",
+            crc_type, name, crc_type, crc_type, crc_type, name, crc_type);
 
-    // Multiply mod poly for CRC combination.
-    if (model->ref)
-        fprintf(code,
+    // Multiply mod poly for CRC combination. This is done a byte of a at a
+    // time, using table_byte[] to multiply the product by x^8, and tables of b
+    // times all polynomials of degree less than four, for each half of a byte
+    // of a, built on each call. CRCs shorter than eight bits are multiplied a
+    // bit at a time.
+    if (model->width < 8) {
+        if (model->ref)
+            fprintf(code,
         "\n"
         "static %s multmodp(%s a, %s b) {\n"
         "    %s prod = 0;\n"
@@ -797,11 +1193,11 @@ int crc_gen(model_t *model, char *name,
         "    }\n"
         "    return prod;\n"
         "}\n",
-            crc_type, crc_type, crc_type, crc_type,
-                (word_t)1 << (model->width - 1),
-                ((word_t)1 << (model->width - 1)) - 1, model->poly);
-    else {
-        fprintf(code,
+                crc_type, crc_type, crc_type, crc_type,
+                    (word_t)1 << (model->width - 1),
+                    ((word_t)1 << (model->width - 1)) - 1, model->poly);
+        else
+            fprintf(code,
         "\n"
         "static %s multmodp(%s a, %s b) {\n"
         "    %s prod = 0;\n"
@@ -813,46 +1209,137 @@ int crc_gen(model_t *model, char *name,
         "        }\n"
         "        a >>= 1;\n"
         "        b = b & %#"X" ? (b << 1) ^ %#"X" : b << 1;\n"
-        "    }\n",
+        "    }\n"
+        "    prod &= %#"X";\n"
+        "    return prod;\n"
+        "}\n",
+                crc_type, crc_type, crc_type, crc_type,
+                (word_t)1 << (model->width - 1), model->poly,
+                ONES(model->width));
+    }
+    else {
+        unsigned r = model->width & 7, bytes = model->width >> 3;
+        fprintf(code,
+        "\n"
+        "static %s multmodp(%s a, %s b) {\n"
+        "    %s lo[16], hi[16];\n"
+        "    for (unsigned k = 0; k < 4; k++) {\n"
+        "        lo[%s] = b;\n",
             crc_type, crc_type, crc_type, crc_type,
-            (word_t)1 << (model->width - 1), model->poly);
-        if (model->width != crc_bits)
+            model->ref ? "8 >> k" : "1 << k");
+        if (model->ref)
+            fprintf(code,
+        "        b = b & 1 ? (b >> 1) ^ %#"X" : b >> 1;\n"
+        "    }\n"
+        "    for (unsigned k = 0; k < 4; k++) {\n"
+        "        hi[8 >> k] = b;\n"
+        "        b = b & 1 ? (b >> 1) ^ %#"X" : b >> 1;\n"
+        "    }\n", model->poly, model->poly);
+        else if (model->width == crc_bits)
+            fprintf(code,
+        "        b = b & %#"X" ? (b << 1) ^ %#"X" : b << 1;\n"
+        "    }\n"
+        "    for (unsigned k = 0; k < 4; k++) {\n"
+        "        hi[1 << k] = b;\n"
+        "        b = b & %#"X" ? (b << 1) ^ %#"X" : b << 1;\n"
+        "    }\n",
+                (word_t)1 << (model->width - 1), model->poly,
+                (word_t)1 << (model->width - 1), model->poly);
+        else
             fprintf(code,
-        "    prod &= %#"X";\n", ONES(model->width));
+        "        b = b & %#"X" ? ((b << 1) ^ %#"X") & %#"X" : b << 1;\n"
+        "    }\n"
+        "    for (unsigned k = 0; k < 4; k++) {\n"
+        "        hi[1 << k] = b;\n"
+        "        b = b & %#"X" ? ((b << 1) ^ %#"X") & %#"X" : b << 1;\n"
+        "    }\n",
+                (word_t)1 << (model->width - 1), model->poly,
+                ONES(model->width), (word_t)1 << (model->width - 1),
+                model->poly, ONES(model->width));
+        fputs(
+        "    lo[0] = hi[0] = 0;\n"
+        "    for (unsigned n = 3; n < 16; n++)\n"
+        "        if (n & (n - 1)) {\n"
+        "            lo[n] = lo[n & (n - 1)] ^ lo[n & -n];\n"
+        "            hi[n] = hi[n & (n - 1)] ^ hi[n & -n];\n"
+        "        }\n", code);
+
+        // Horner's method over the bytes of a, from the highest powers of x
+        // to the lowest, starting with the partial byte if the width is not a
+        // multiple of eight
+        fprintf(code,
+        "    %s prod = 0;\n", crc_type);
+        if (model->ref) {
+            if (r)
+                fprintf(code,
+        "    unsigned t = (a & %#x) << %u;\n"
+        "    prod = hi[t & 15] ^ lo[t >> 4];\n"
+        "    a >>= %u;\n", (1U << r) - 1, 8 - r, r);
+            fprintf(code,
+        "    for (unsigned i = 0; i < %u; i++) {\n"
+        "        unsigned c = a & 0xff;\n"
+        "        a >>= 8;\n", bytes);
+            if (model->width > 8)
+                fputs(
+        "        prod = (prod >> 8) ^ table_byte[prod & 0xff] ^\n", code);
+            else
+                fputs(
+        "        prod = table_byte[prod] ^\n", code);
+            fputs(
+        "               hi[c & 15] ^ lo[c >> 4];\n"
+        "    }\n", code);
+        }
+        else {
+            if (r)
+                fprintf(code,
+        "    unsigned t = a >> %u;\n"
+        "    prod = lo[t & 15] ^ hi[t >> 4];\n", bytes << 3);
+            fprintf(code,
+        "    for (unsigned i = %u; i--;) {\n"
+        "        unsigned c = (a >> (i << 3)) & 0xff;\n", bytes);
+            if (model->width == 8)
+                fputs(
+        "        prod = table_byte[prod] ^\n", code);
+            else if (model->width == crc_bits)
+                fprintf(code,
+        "        prod = (prod << 8) ^ table_byte[prod >> %u] ^\n",
+                    model->width - 8);
+            else
+                fprintf(code,
+        "        prod = ((prod << 8) & %#"X") ^ table_byte[prod >> %u] ^\n",
+                    ONES(model->width), model->width - 8);
+            fputs(
+        "               lo[c & 15] ^ hi[c >> 4];\n"
+        "    }\n", code);
+        }
         fputs(
         "    return prod;\n"
         "}\n", code);
     }
 
-    // Calculate x^(8n) mod poly for CRC combination.
+    // Calculate x^(8n) mod poly for CRC combination. If the powers cycle, then
+    // n is first reduced modulo 2^cycle - 1, for which x^(8n) is one.
     fprintf(code,
         "\n"
         "static %s x8nmodp(uintmax_t n) {\n", crc_type);
-    if (model->ref)
+    if (model->cycle < WORDBITS)
         fprintf(code,
-        "    %s xp = %#"X";\n",
-        crc_type, (word_t)1 << (model->width - 1));
-    else
-        fprintf(code,
-        "    %s xp = 1;\n", crc_type);
-    fputs(
-        "    unsigned k = 0;\n"
-        "    while (n) {\n"
-        "        if (n & 1)\n"
-        "            xp = multmodp(table_comb[k], xp);\n"
-        "        n >>= 1;\n", code);
-    if (model->cycle < word_bits)
-        fprintf(code,
-        "        if (++k == %u)\n"
-        "            k = 0;\n",
-                model->cycle);
-    else
-        fputs(
-        "        k++;\n", code);
+        "    n %%= ((uintmax_t)1 << %u) - 1;\n", model->cycle);
     fputs(
+        "    unsigned i = 0;\n"
+        "    while (n && (n & 15) == 0) {\n"
+        "        n >>= 4;\n"
+        "        i++;\n"
+        "    }\n", code);
+    fprintf(code,
+        "    %s xp = table_pow[i][n & 15];\n"
+        "    while (n >>= 4) {\n"
+        "        i++;\n"
+        "        if (n & 15)\n"
+        "            xp = multmodp(table_pow[i][n & 15], xp);\n"
         "    }\n"
         "    return xp;\n"
-        "}\n", code);
+        "}\n", crc_type);
 
     // Combine CRCs.
     fprintf(code,
@@ -873,5 +1360,189 @@ int crc_gen(model_t *model, char *name,
         "    return multmodp(x8nmodp(len2), crc1) ^ crc2;\n", code);
     fputs(
         "}\n", code);
+
+    // Shift a CRC over zeros.
+    fprintf(code,
+        "\n"
+        "%s %s_shift(%s crc, uintmax_t len) {\n",
+        crc_type, name, crc_type);
+    if (model->xorout)
+        fprintf(code,
+        "    crc ^= %#"X";\n", model->xorout);
+    if (model->rev)
+        fprintf(code,
+        "    crc = revlow%d(crc);\n", model->width);
+    else if (model->width != crc_bits)
+        fprintf(code,
+        "    crc &= %#"X";\n", ONES(model->width));
+    fputs(
+        "    crc = multmodp(x8nmodp(len), crc);\n", code);
+    if (model->rev)
+        fprintf(code,
+        "    crc = revlow%d(crc);\n", model->width);
+    if (model->xorout)
+        fprintf(code,
+        "    crc ^= %#"X";\n", model->xorout);
+    fputs(
+        "    return crc;\n"
+        "}\n", code);
+
+    // Carry-less multiply CRC calculation function. The folding is compiled
+    // only for x86-64 with gcc or clang, and used only if the processor has
+    // the instructions. Otherwise, and for the bytes after the last 16-byte
+    // block, the word-wise function is used.
+    fprintf(head,
+        "\n"
+        "// Compute the CRC using carry-less multiplication where available,\n"
+        "// falling back to _word.\n"
+        "%s %s_clmul(%s crc, void const *mem, size_t len);\n",
+            crc_type, name, crc_type);
+    fputs(
+        "\n"
+        "#if defined(__GNUC__) && defined(__x86_64__)\n"
+        "#  include <immintrin.h>\n"
+        "#  define CLMUL __attribute__((target(\"pclmul,ssse3\")))\n"
+        "\n"
+        "static uint64_t const table_clmul[] = {\n", code);
+    for (unsigned k = 0; k < 7; k++)
+        fprintf(code,
+        "    0x%016"X"%s\n", model->table_clmul[k], k < 6 ? "," : "");
+    fputs(
+        "};\n"
+        "\n"
+        "CLMUL static inline __m128i clmul(uint64_t a, uint64_t b) {\n"
+        "    return _mm_clmulepi64_si128(_mm_cvtsi64_si128(a),\n"
+        "                                _mm_cvtsi64_si128(b), 0);\n"
+        "}\n"
+        "\n"
+        "CLMUL static inline uint64_t low64(__m128i x) {\n"
+        "    return _mm_cvtsi128_si64(x);\n"
+        "}\n"
+        "\n"
+        "CLMUL static inline uint64_t high64(__m128i x) {\n"
+        "    return _mm_cvtsi128_si64(_mm_unpackhi_epi64(x, x));\n"
+        "}\n"
+        "\n"
+        "CLMUL static inline __m128i fold(__m128i x, __m128i k) {\n"
+        "    return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00),\n"
+        "                         _mm_clmulepi64_si128(x, k, 0x11));\n"
+        "}\n"
+        "\n"
+        "CLMUL static inline __m128i load(unsigned char const *data) {\n", code);
+    if (model->ref)
+        fputs(
+        "    return _mm_loadu_si128((__m128i const *)data);\n", code);
+    else
+        fputs(
+        "    return _mm_shuffle_epi8(_mm_loadu_si128((__m128i const *)data),\n"
+        "                            _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,\n"
+        "                                         8, 9, 10, 11, 12, 13, 14, 15));\n",
+              code);
+    char first[16];                     // crc in the first 128 bits
+    if (model->ref || model->width == 64)
+        strcpy(first, model->ref ? "0, crc" : "crc, 0");
+    else
+        sprintf(first, "crc << %u, 0", 64 - model->width);
+    fprintf(code,
+        "}\n"
+        "\n"
+        "// Fold len bytes at data into crc, where len is a multiple of 16 and at\n"
+        "// least 64.\n"
+        "CLMUL static uint64_t fold_crc(uint64_t crc, unsigned char const *data,\n"
+        "                               size_t len) {\n"
+        "    uint64_t const *k = table_clmul;\n"
+        "    __m128i x0 = load(data), x1 = load(data + 16),\n"
+        "            x2 = load(data + 32), x3 = load(data + 48);\n"
+        "    x0 = _mm_xor_si128(x0, _mm_set_epi64x(%s));\n"
+        "    data += 64;\n"
+        "    len -= 64;\n"
+        "    __m128i kf = _mm_set_epi64x(k[1], k[0]);\n"
+        "    while (len >= 64) {\n"
+        "        x0 = _mm_xor_si128(fold(x0, kf), load(data));\n"
+        "        x1 = _mm_xor_si128(fold(x1, kf), load(data + 16));\n"
+        "        x2 = _mm_xor_si128(fold(x2, kf), load(data + 32));\n"
+        "        x3 = _mm_xor_si128(fold(x3, kf), load(data + 48));\n"
+        "        data += 64;\n"
+        "        len -= 64;\n"
+        "    }\n"
+        "    kf = _mm_set_epi64x(k[3], k[2]);\n"
+        "    x0 = _mm_xor_si128(fold(x0, kf), x1);\n"
+        "    x0 = _mm_xor_si128(fold(x0, kf), x2);\n"
+        "    x0 = _mm_xor_si128(fold(x0, kf), x3);\n"
+        "    while (len) {\n"
+        "        x0 = _mm_xor_si128(fold(x0, kf), load(data));\n"
+        "        data += 16;\n"
+        "        len -= 16;\n"
+        "    }\n",
+            first);
+    if (model->ref)
+        fputs(
+        "    __m128i t = clmul(low64(x0), k[4]);\n"
+        "    uint64_t hi = low64(t) ^ high64(x0);\n"
+        "    uint64_t q = hi ^ (low64(clmul(hi, k[5])) << 1);\n"
+        "    __m128i r = clmul(q, k[6]);\n"
+        "    return high64(t) ^ (high64(r) << 1) ^ (low64(r) >> 63);\n"
+        "}\n", code);
+    else {
+        fputs(
+        "    __m128i t = clmul(high64(x0), k[4]);\n"
+        "    uint64_t hi = high64(t) ^ low64(x0);\n"
+        "    uint64_t q = hi ^ high64(clmul(hi, k[5]));\n", code);
+        if (model->width == 64)
+            fputs(
+        "    return low64(t) ^ low64(clmul(q, k[6]));\n"
+        "}\n", code);
+        else
+            fprintf(code,
+        "    return (low64(t) ^ low64(clmul(q, k[6]))) >> %u;\n"
+        "}\n", 64 - model->width);
+    }
+    fputs(
+        "#endif\n", code);
+    fprintf(code,
+        "\n"
+        "%s %s_clmul(%s crc, void const *mem, size_t len) {\n"
+        "    unsigned char const *data = mem;\n"
+        "    if (data == NULL)\n"
+        "        return %#"X";\n"
+        "#if defined(__GNUC__) && defined(__x86_64__)\n"
+        "    if (len >= 64 && __builtin_cpu_supports(\"pclmul\") &&\n"
+        "        __builtin_cpu_supports(\"ssse3\")) {\n"
+        "        size_t n = len & ~(size_t)15;\n",
+            crc_type, name, crc_type, model->init);
+    if (model->xorout) {
+        if (model->xorout == ONES(model->width) && crc_bits == model->width)
+            fputs(
+        "        crc = ~crc;\n", code);
+        else
+            fprintf(code,
+        "        crc ^= %#"X";\n", model->xorout);
+    }
+    if (model->rev)
+        fprintf(code,
+        "        crc = revlow%d(crc);\n", model->width);
+    if (model->width != crc_bits && !model->rev)
+        fprintf(code,
+        "        crc &= %#"X";\n", ONES(model->width));
+    fputs(
+        "        crc = fold_crc(crc, data, n);\n", code);
+    if (model->rev)
+        fprintf(code,
+        "        crc = revlow%d(crc);\n", model->width);
+    if (model->xorout) {
+        if (model->xorout == ONES(model->width) && crc_bits == model->width)
+            fputs(
+        "        crc = ~crc;\n", code);
+        else
+            fprintf(code,
+        "        crc ^= %#"X";\n", model->xorout);
+    }
+    fprintf(code,
+        "        data += n;\n"
+        "        len -= n;\n"
+        "    }\n"
+        "#endif\n"
+        "    return %s_word(crc, data, len);\n"
+        "}\n", name);
     return 0;
 }
@@ -16,15 +16,48 @@
 // success, non-zero if the first argument is not valid.
 int rev_gen(int, FILE *);
 
+// A shared table section, to which crc_gen() writes each unique set of tables
+// once for all of the CRCs generated with it, instead of writing the tables to
+// the code for each CRC.
+typedef struct share_s share_t;
+
+// Return a new shared table section, with the header and code written to the
+// second and third arguments. The first argument is the base name of the
+// section's source files, for the generated CRC code to include the header.
+// Return NULL if out of memory.
+share_t *share_new(char *, FILE *, FILE *);
+
+// Free a shared table section. The files are not closed.
+void share_free(share_t *);
+
 // Generate the header and code for the CRC described in the first argument.
 // The second argument is the prefix string used for all externally visible
 // names in the source files. The generated word-wise CRC code uses the
 // endianess in the third argument (1 for little endian, 0 for big endian), and
 // the word size in bits in the fourth argument, which must be 32 or 64. The
 // width of the CRC in model must be less than or equal to the word size. The
-// generated header is written to the fifth argument, and the code is written
-// to the last argument. Return 0 on success, non-zero if word_bits and
-// model->width are invalid.
-int crc_gen(model_t *, char *, unsigned, unsigned, FILE *, FILE *);
+// fifth argument is the number of bytes the word-wise code processes at each
+// step, with one table of 256 entries for each byte, which must be a multiple
+// of the word size in bytes, up to 64, or zero for one word. If the sixth
+// argument is not zero, then a braided _braid function is generated as well,
+// which runs that many independent CRCs on interleaved words, using one more
+// table of 256 entries for each byte in a word. The lanes times the word size
+// in bytes can be at most 64. A value of 1 picks the number of lanes for the
+// word size. If the seventh argument is not NULL, then the tables are taken
+// from or added to that shared table section, which must be used with the same
+// endianess, word size, slices, and braids for all of its CRCs. The tables
+// depend only on the width, polynomial, and reflection of the CRC, with init
+// and xorout applied in the code. The generated header is written to the
+// eighth argument, and the code is written to the last argument. The generated
+// code has _bit, _rem, _byte, _word, _comb, _shift, and _clmul functions.
+// _comb and _shift use a table of powers of x and a byte-wise multiply, taking
+// at most one multiply for each hexadecimal digit of the length. _clmul uses
+// carry-less multiply intrinsics on x86-64 with gcc or clang if the processor
+// has the instructions, or _word if not. Return 0 on success, 1 if word_bits,
+// slices, braids, and model->width are invalid or do not match the shared
+// table section, or 2 if out of memory. Tables are allocated in model, and
+// should be freed when done with free_model().
+int crc_gen(model_t *, char *, unsigned, unsigned, unsigned, unsigned,
+            share_t *, FILE *, FILE *);
 
 #endif
@@ -0,0 +1,330 @@
+/* crcmap.c -- Memory-mapped packs of CRC models and tables
+ * Copyright (C) 2021 Mark Adler
+ * For conditions of distribution and use, see copyright notice in crcany.c.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "crcmap.h"
+#include "crc.h"
+
+// The first eight bytes of a pack, the last character being the version of
+// the format.
+#define MAGIC "crcpack1"
+
+// Alignment of the tables in a pack, which is a cache line.
+#define ALIGN 64
+
+// The header of a pack, at the start of the file. It is followed by count
+// descriptors, then the names, and then the tables. All of the integers are
+// in the byte order of the machine that wrote the pack.
+typedef struct {
+    char magic[8];              // MAGIC
+    uint32_t bits;              // WORDBITS of the machine that wrote the pack
+    uint32_t little;            // true if that machine is little-endian
+    uint32_t count;             // number of models
+    uint32_t unused;            // zero
+    uint64_t size;              // length of the pack in bytes
+} head_t;
+
+// The description of a model in a pack, as processed by process_model().
+typedef struct {
+    word_t poly, poly_hi;
+    word_t init, init_hi;
+    word_t xorout, xorout_hi;
+    word_t check, check_hi;
+    word_t res, res_hi;
+    uint64_t name;              // offset of the zero-terminated name
+    uint64_t table;             // offset of the tables, or 0 if none
+    uint16_t width;             // number of bits in the CRC
+    uint16_t slices;            // number of word-wise tables
+    uint8_t ref, rev;           // reflection and reversal
+    uint8_t bytes, shift;       // table_bytes and table_shift
+} desc_t;
+
+struct crc_map_s {
+    unsigned char *base;        // start of the mapped pack
+    size_t size;                // length of the mapped pack
+};
+
+// Return the native endianess, 1 for little-endian, 0 for big-endian.
+static unsigned native_little(void) {
+    unsigned little = 1;
+    return *((unsigned char *)(&little));
+}
+
+// Return the number of bytes in the tables of model.
+static size_t table_size(model_t const *model) {
+    return ((size_t)model->slices + 1) * 256 * model->table_bytes;
+}
+
+// Write len bytes from buf to out, or len zeros if buf is NULL. Return 0 on
+// success, or 3 on a write error.
+static int put(FILE *out, void const *buf, size_t len) {
+    static unsigned char const zeros[ALIGN];
+    if (buf == NULL) {
+        while (len > sizeof(zeros)) {
+            if (fwrite(zeros, 1, sizeof(zeros), out) != sizeof(zeros))
+                return 3;
+            len -= sizeof(zeros);
+        }
+        buf = zeros;
+    }
+    return fwrite(buf, 1, len, out) == len ? 0 : 3;
+}
+
+int crc_map_write(FILE *out, model_t *models, unsigned count) {
+    // Build the word-wise tables for the models that need them.
+    unsigned little = native_little();
+    for (unsigned i = 0; i < count; i++) {
+        model_t *model = models + i;
+        if (model->width <= WORDBITS &&
+            (model->table_word == NULL || model->table_bits != WORDBITS ||
+             model->table_little != little) &&
+            crc_table_wordwise(model, little, WORDBITS, WORDCHARS))
+            return 2;
+    }
+
+    // Lay out the pack, putting one copy of the tables for each set of models
+    // with the same tables.
+    desc_t *desc = calloc(count ? count : 1, sizeof(desc_t));
+    if (desc == NULL)
+        return 2;
+    uint64_t pos = sizeof(head_t) + (uint64_t)count * sizeof(desc_t);
+    for (unsigned i = 0; i < count; i++) {
+        desc[i].name = pos;
+        pos += strlen(models[i].name == NULL ? "" : models[i].name) + 1;
+    }
+    uint64_t names = pos;
+    for (unsigned i = 0; i < count; i++) {
+        model_t const *model = models + i;
+        if (model->width > WORDBITS)
+            continue;
+        for (unsigned j = 0; j < i; j++) {
+            model_t const *prev = models + j;
+            if (prev->width == model->width && prev->poly == model->poly &&
+                prev->ref == model->ref && prev->slices == model->slices) {
+                desc[i].table = desc[j].table;
+                break;
+            }
+        }
+        if (desc[i].table == 0) {
+            pos = (pos + ALIGN - 1) & ~(uint64_t)(ALIGN - 1);
+            desc[i].table = pos;
+            pos += table_size(model);
+        }
+    }
+    for (unsigned i = 0; i < count; i++) {
+        model_t const *model = models + i;
+        desc_t *d = desc + i;
+        d->poly = model->poly;
+        d->poly_hi = model->poly_hi;
+        d->init = model->init;
+        d->init_hi = model->init_hi;
+        d->xorout = model->xorout;
+        d->xorout_hi = model->xorout_hi;
+        d->check = model->check;
+        d->check_hi = model->check_hi;
+        d->res = model->res;
+        d->res_hi = model->res_hi;
+        d->width = model->width;
+        d->ref = model->ref;
+        d->rev = model->rev;
+        if (d->table) {
+            d->slices = model->slices;
+            d->bytes = model->table_bytes;
+            d->shift = model->table_shift;
+        }
+    }
+    head_t head;
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, MAGIC, sizeof(head.magic));
+    head.bits = WORDBITS;
+    head.little = little;
+    head.count = count;
+    head.size = pos;
+
+    // Write the pack.
+    int ret = put(out, &head, sizeof(head));
+    if (ret == 0 && count)
+        ret = put(out, desc, count * sizeof(desc_t));
+    for (unsigned i = 0; ret == 0 && i < count; i++) {
+        char const *name = models[i].name == NULL ? "" : models[i].name;
+        ret = put(out, name, strlen(name) + 1);
+    }
+    pos = names;
+    for (unsigned i = 0; ret == 0 && i < count; i++)
+        if (desc[i].table >= pos) {
+            ret = put(out, NULL, desc[i].table - pos);
+            if (ret == 0)
+                ret = put(out, models[i].table_word, table_size(models + i));
+            pos = desc[i].table + table_size(models + i);
+        }
+    free(desc);
+    if (ret == 0 && fflush(out))
+        ret = 3;
+    return ret;
+}
+
+// Return true if the double word hi, lo fits in width bits.
+static int fits(word_t hi, word_t lo, unsigned width) {
+    if (width <= WORDBITS)
+        return hi == 0 && (lo & ~ONES(width)) == 0;
+    return (hi & ~ONES(width - WORDBITS)) == 0;
+}
+
+// Return 0 if the pack at base of length size is valid for this machine, or
+// 1 if not. The parameters of each model must fit in its width, and its
+// tables must have the entry size and shift that crc_table_wordwise() would
+// use, since the CRC routines index the tables with values that depend on
+// those.
+static int map_verify(unsigned char const *base, size_t size) {
+    head_t head;
+    if (size < sizeof(head))
+        return 1;
+    memcpy(&head, base, sizeof(head));
+    if (memcmp(head.magic, MAGIC, sizeof(head.magic)) ||
+        head.bits != WORDBITS || head.little != native_little() ||
+        head.size != size ||
+        head.count > (size - sizeof(head)) / sizeof(desc_t))
+        return 1;
+    desc_t const *desc = (desc_t const *)(base + sizeof(head));
+    for (unsigned i = 0; i < head.count; i++) {
+        desc_t const *d = desc + i;
+        if (d->name >= size ||
+            memchr(base + d->name, 0, size - d->name) == NULL ||
+            d->width < 1 || d->width > 2 * WORDBITS || d->ref > 1 ||
+            d->rev > 1 || !fits(d->poly_hi, d->poly, d->width) ||
+            !fits(d->init_hi, d->init, d->width) ||
+            !fits(d->xorout_hi, d->xorout, d->width) ||
+            !fits(d->check_hi, d->check, d->width) ||
+            !fits(d->res_hi, d->res, d->width))
+            return 1;
+        if (d->width > WORDBITS) {
+            if (d->table)
+                return 1;
+            continue;
+        }
+        unsigned shift;
+        unsigned bytes = crc_table_narrow(d->width, d->ref, head.little,
+                                          WORDBITS, &shift);
+        if (d->table == 0 || d->table % ALIGN ||
+            d->bytes != bytes || d->shift != shift ||
+            d->slices == 0 || d->slices > 64 || d->slices % WORDCHARS ||
+            d->table > size ||
+            ((uint64_t)d->slices + 1) * 256 * d->bytes > size - d->table)
+            return 1;
+    }
+    return 0;
+}
+
+int crc_map_open(crc_map_t **map, char const *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return 3;
+    struct stat st;
+    if (fstat(fd, &st)) {
+        close(fd);
+        return 3;
+    }
+    if ((size_t)st.st_size < sizeof(head_t)) {
+        close(fd);
+        return 1;
+    }
+    size_t size = st.st_size;
+    void *base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return 3;
+    int ret = map_verify(base, size);
+    if (ret == 0) {
+        *map = malloc(sizeof(crc_map_t));
+        if (*map == NULL)
+            ret = 2;
+    }
+    if (ret) {
+        munmap(base, size);
+        return ret;
+    }
+    (*map)->base = base;
+    (*map)->size = size;
+    return 0;
+}
+
+// Return the header of the pack.
+static head_t const *map_head(crc_map_t const *map) {
+    return (head_t const *)map->base;
+}
+
+// Return the descriptors of the pack.
+static desc_t const *map_desc(crc_map_t const *map) {
+    return (desc_t const *)(map->base + sizeof(head_t));
+}
+
+unsigned crc_map_count(crc_map_t const *map) {
+    return map_head(map)->count;
+}
+
+int crc_map_find(crc_map_t const *map, char const *name) {
+    desc_t const *desc = map_desc(map);
+    for (unsigned i = 0; i < map_head(map)->count; i++) {
+        unsigned char const *p = map->base + desc[i].name,
+                            *q = (unsigned char const *)name;
+        while (*p && tolower(*p) == tolower(*q)) {
+            p++;
+            q++;
+        }
+        if (*p == 0 && *q == 0)
+            return i;
+    }
+    return -1;
+}
+
+int crc_map_model(crc_map_t const *map, unsigned index, model_t *model) {
+    if (index >= map_head(map)->count)
+        return 1;
+    desc_t const *d = map_desc(map) + index;
+    char const *name = (char const *)map->base + d->name;
+    model->name = malloc(strlen(name) + 1);
+    if (model->name == NULL)
+        return 2;
+    strcpy(model->name, name);
+    model->width = d->width;
+    model->cycle = 0;
+    model->ref = d->ref;
+    model->rev = d->rev;
+    model->poly = d->poly;
+    model->poly_hi = d->poly_hi;
+    model->init = d->init;
+    model->init_hi = d->init_hi;
+    model->xorout = d->xorout;
+    model->xorout_hi = d->xorout_hi;
+    model->check = d->check;
+    model->check_hi = d->check_hi;
+    model->res = d->res;
+    model->res_hi = d->res_hi;
+    clear_model(model);
+    if (d->table) {
+        model->table_word = map->base + d->table;
+        model->table_shared = 1;
+        model->slices = d->slices;
+        model->table_bytes = d->bytes;
+        model->table_shift = d->shift;
+        model->table_little = map_head(map)->little;
+        model->table_bits = WORDBITS;
+        model->table_top = model->ref ? 0 :
+            WORDBITS - (model->width > 8 ? model->width : 8);
+    }
+    return 0;
+}
+
+void crc_map_close(crc_map_t *map) {
+    munmap(map->base, map->size);
+    free(map);
+}
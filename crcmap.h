@@ -0,0 +1,66 @@
+/* crcmap.h -- Memory-mapped packs of CRC models and tables
+ * Copyright (C) 2021 Mark Adler
+ * For conditions of distribution and use, see copyright notice in crcany.c.
+ */
+
+#ifndef _CRCMAP_H_
+#define _CRCMAP_H_
+
+#include <stdio.h>
+#include "model.h"
+
+/* A pack is one binary file with the descriptions of a list of CRC models,
+   and the narrow word-wise tables for each model that fits in a word_t, as
+   built by crc_table_wordwise() for the machine writing the pack. The tables
+   are aligned in the file so that they can be used directly from a read-only
+   memory mapping of the file. Then a program only needs to map the file to
+   have its tables, instead of computing them, and all of the processes on a
+   machine that map the same pack share the same physical memory for them.
+   Models that differ only in init or xorout share one copy of the tables in
+   the pack, as they do in the registry of crc_table_shared().
+
+   A pack can only be used on a machine with the same word_t size and
+   endianess as the one that wrote it. */
+typedef struct crc_map_s crc_map_t;
+
+/* Write a pack with the count models at models to out. The models must have
+   been processed by process_model(). The word-wise tables of the models that
+   fit in a word_t are built using crc_table_wordwise() with one word of
+   slices, if they have not already been built with some number of slices for
+   the machine being run on. Return 0 on success, 2 if out of memory, or 3 if
+   there was an error writing to out. */
+int crc_map_write(FILE *out, model_t *models, unsigned count);
+
+/* Map the pack in the file at path, read-only, and verify its contents,
+   setting *map to the mapped pack. The parameters of each model must fit in
+   its width, and its tables must have the entry size and shift given by
+   crc_table_narrow(), so that a corrupted pack cannot lead the CRC routines
+   outside of the tables. Return 0 on success, 1 if the file is not a valid
+   pack for the machine being run on, 2 if out of memory, or 3 if the file
+   could not be opened or mapped. */
+int crc_map_open(crc_map_t **map, char const *path);
+
+/* Return the number of models in the pack. */
+unsigned crc_map_count(crc_map_t const *map);
+
+/* Return the index of the model in the pack whose name matches name,
+   ignoring case, or -1 if there is none. */
+int crc_map_find(crc_map_t const *map, char const *name);
+
+/* Fill in *model with the description of model index in the pack, as
+   processed by process_model(), and with the word-wise tables from the pack,
+   if the model fits in a word_t. The tables are shared as for
+   crc_table_shared(), so model->table_shared is set, and they are not freed
+   by free_model(). crc_bytewise() and crc_wordwise() can then be used
+   directly. The other tables are not in the pack, and are built as usual by
+   their routines if needed. model->name is allocated, and free_model() must
+   be used when done with the model. Return 0 on success, 1 if index is out of
+   range, or 2 if out of memory. */
+int crc_map_model(crc_map_t const *map, unsigned index, model_t *model);
+
+/* Unmap the pack and free map. The models filled in from it must not be used
+   for word-wise or byte-wise calculations after this, but can still be
+   freed with free_model(). */
+void crc_map_close(crc_map_t *map);
+
+#endif
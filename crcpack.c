@@ -0,0 +1,178 @@
+/* crcpack.c -- Write or verify a pack of CRC models and tables
+ * Copyright (C) 2021 Mark Adler
+ * For conditions of distribution and use, see copyright notice in crcany.c.
+ */
+
+/*
+   crcpack pack < models
+
+   Read a series of CRC model descriptions from stdin, one per line, in the
+   same form as for crctest, and write them with their word-wise tables to the
+   file pack, which can then be memory-mapped by crc_map_open().
+
+   crcpack -v pack
+
+   Map the file pack, and verify the check value of each model in it using the
+   byte-wise and word-wise calculations with the mapped tables, and using the
+   bit-wise calculation for models longer than a word_t, as well as verifying
+   the word-wise calculation against the bit-wise calculation on some data.
+   The time it took to map the pack and get all of its models is shown.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "model.h"
+#include "crc.h"
+#include "crcdbl.h"
+#include "crcmap.h"
+
+// Return the current time in seconds.
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// Read the models from stdin and write the pack to path. Return 0 on success,
+// or 1 on an error.
+static int pack(char const *path) {
+    model_t *models = NULL;
+    unsigned count = 0, max = 0;
+    char *line = NULL;
+    size_t size;
+    ptrdiff_t len;
+    int ret = 0;
+    while (ret == 0 && (len = getcleanline(&line, &size, stdin)) != -1) {
+        if (len == 0)
+            continue;
+        if (count == max) {
+            max = max ? max << 1 : 64;
+            void *mem = realloc(models, max * sizeof(model_t));
+            if (mem == NULL) {
+                ret = 2;
+                break;
+            }
+            models = mem;
+        }
+        ret = read_model(models + count, line, 0);
+        if (ret == 0) {
+            process_model(models + count++);
+            continue;
+        }
+        if (ret == 1) {
+            fprintf(stderr, "%s: -- unusable model\n",
+                    models[count].name == NULL ? "<no name>" :
+                                                 models[count].name);
+            ret = 0;
+        }
+        free_model(models + count);
+    }
+    free(line);
+    if (ret == 0) {
+        FILE *out = fopen(path, "wb");
+        if (out == NULL)
+            ret = 3;
+        else {
+            ret = crc_map_write(out, models, count);
+            if (fclose(out) && ret == 0)
+                ret = 3;
+        }
+    }
+    for (unsigned i = 0; i < count; i++)
+        free_model(models + i);
+    free(models);
+    if (ret == 2)
+        fputs("out of memory -- aborting\n", stderr);
+    else if (ret == 3)
+        perror(path);
+    else
+        printf("%u models written to %s\n", count, path);
+    return ret != 0;
+}
+
+// Verify the models in the pack at path. Return 0 if all good, or 1 if not.
+static int verify(char const *path) {
+    static unsigned char const test[] = "123456789";
+    unsigned char data[1000];
+    uint64_t ran = 1;
+    for (size_t n = 0; n < sizeof(data); n++) {
+        ran = ran * 6364136223846793005 + 1442695040888963407;
+        data[n] = ran >> 56;
+    }
+
+    // map the pack and get all of its models
+    double start = now();
+    crc_map_t *map;
+    int ret = crc_map_open(&map, path);
+    if (ret) {
+        if (ret == 1)
+            fprintf(stderr, "%s: not a valid pack for this machine\n", path);
+        else if (ret == 2)
+            fputs("out of memory -- aborting\n", stderr);
+        else
+            perror(path);
+        return 1;
+    }
+    unsigned count = crc_map_count(map);
+    model_t *models = calloc(count ? count : 1, sizeof(model_t));
+    if (models == NULL) {
+        fputs("out of memory -- aborting\n", stderr);
+        crc_map_close(map);
+        return 1;
+    }
+    for (unsigned i = 0; i < count; i++)
+        if (crc_map_model(map, i, models + i)) {
+            fputs("out of memory -- aborting\n", stderr);
+            count = i;
+            ret = 1;
+        }
+    double took = now() - start;
+
+    // verify each model
+    unsigned good = 0;
+    for (unsigned i = 0; i < count; i++) {
+        model_t *model = models + i;
+        int ok = crc_map_find(map, model->name) == (int)i;
+        if (model->width > WORDBITS) {
+            word_t hi, lo;
+            crc_bitwise_dbl(model, &hi, &lo, NULL, 0);
+            crc_bitwise_dbl(model, &hi, &lo, test, 9);
+            ok = ok && hi == model->check_hi && lo == model->check;
+        }
+        else {
+            ok = ok &&
+                 crc_bytewise(model, model->init, test, 9) == model->check &&
+                 crc_wordwise(model, model->init, test, 9) == model->check;
+            for (unsigned k = 0; ok && k < 16; k++)
+                ok = crc_wordwise(model, model->init, data + k, 500 + k) ==
+                     crc_bitwise(model, model->init, data + k, 500 + k);
+        }
+        if (ok)
+            good++;
+        else
+            printf("%s: pack fail\n", model->name);
+        free_model(model);
+    }
+    free(models);
+    crc_map_close(map);
+    printf("%u models verified from pack out of %u (mapped in %.1f us)\n",
+           good, count, took * 1e6);
+    puts(ret == 0 && good == count ? "-- all good" :
+                                     "** verification failed");
+    return ret != 0 || good != count;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 2 && argv[1][0] != '-')
+        return pack(argv[1]);
+    if (argc == 3 && strcmp(argv[1], "-v") == 0)
+        return verify(argv[2]);
+    fputs("usage: crcpack pack < models\n"
+          "       crcpack -v pack\n", stderr);
+    return 1;
+}
@@ -0,0 +1,259 @@
+/* crcpar.c -- Parallel CRC calculation of a large buffer or chain of buffers
+ * Copyright (C) 2021 Mark Adler
+ * For conditions of distribution and use, see copyright notice in crcany.c.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <pthread.h>
+#include <unistd.h>
+#include "crcpar.h"
+#include "crc.h"
+
+// Minimum number of bytes for each thread. Shorter lengths use fewer threads,
+// so that they do not pay for waking up threads that would have little to do.
+#define PAR_MIN 1048576
+
+// Length of a segment at which crc_iov() runs it with crc_fast() instead of
+// with the streaming word-wise calculation. Shorter segments are not worth
+// leaving and restarting the word form of the CRC for.
+#define IOV_LONG 256
+
+// A portion of the data for a worker thread, and its CRC when done. The data
+// is either buf[0..len-1], or if iov is not NULL, len bytes of the segments
+// starting at iov, skipping the first skip bytes of iov[0].
+typedef struct {
+    model_t *model;
+    unsigned char const *buf;
+    struct iovec const *iov;
+    size_t skip;
+    size_t len;
+    word_t crc;
+} job_t;
+
+// The pool of worker threads, reused by successive crc_parallel() and
+// crc_iov_parallel() calls.
+static struct {
+    pthread_mutex_t use;        // held by the crc_parallel() using the pool
+    pthread_mutex_t lock;       // protects the members below
+    pthread_cond_t work;        // signaled when there are jobs or to quit
+    pthread_cond_t done;        // signaled when the last job is done
+    unsigned threads;           // number of worker threads running
+    unsigned next;              // index of the next job to take
+    unsigned jobs;              // number of jobs, the last one plus one
+    unsigned left;              // number of jobs not yet done
+    int quit;                   // true to have the worker threads exit
+    pthread_t tid[CRC_THREADS_MAX];
+    job_t job[CRC_THREADS_MAX];
+} pool = {
+    .use = PTHREAD_MUTEX_INITIALIZER,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER
+};
+
+// Return the CRC of len bytes of the segments starting at iov, skipping the
+// first skip bytes of iov[0], continuing from crc. Runs of short segments are
+// given to a streaming calculation, which carries the partial words from one
+// segment to the next, and long segments are given to crc_fast() directly.
+static word_t iov_run(model_t *model, word_t crc, struct iovec const *iov,
+                      size_t skip, size_t len) {
+    crc_ctx_t ctx;
+    int open = 0;
+    while (len) {
+        unsigned char const *buf = (unsigned char const *)iov->iov_base + skip;
+        size_t n = iov->iov_len - skip;
+        if (n > len)
+            n = len;
+        if (n >= IOV_LONG) {
+            if (open) {
+                crc = crc_ctx_final(&ctx);
+                open = 0;
+            }
+            crc = crc_fast(model, crc, buf, n);
+        }
+        else if (n) {
+            if (!open) {
+                crc_ctx_init(&ctx, model, crc);
+                open = 1;
+            }
+            crc_ctx_update(&ctx, buf, n);
+        }
+        len -= n;
+        skip = 0;
+        iov++;
+    }
+    return open ? crc_ctx_final(&ctx) : crc;
+}
+
+// Take the next job and do it. pool.lock must be held, and is held again on
+// return, but not while computing the CRC.
+static void take(void) {
+    job_t *job = pool.job + pool.next++;
+    pthread_mutex_unlock(&pool.lock);
+    job->crc = job->iov == NULL ?
+        crc_fast(job->model, job->model->init, job->buf, job->len) :
+        iov_run(job->model, job->model->init, job->iov, job->skip, job->len);
+    pthread_mutex_lock(&pool.lock);
+    if (--pool.left == 0)
+        pthread_cond_signal(&pool.done);
+}
+
+// Worker thread: do jobs as they appear, until told to quit.
+static void *worker(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        while (pool.next == pool.jobs && !pool.quit)
+            pthread_cond_wait(&pool.work, &pool.lock);
+        if (pool.quit)
+            break;
+        take();
+    }
+    pthread_mutex_unlock(&pool.lock);
+    return NULL;
+}
+
+// Return the number of threads to use for len bytes, at most nthreads, or
+// one per online processor if nthreads is zero. If more than one, then the
+// pool has been acquired and enough worker threads started, and pool.lock is
+// held for setting up jobs 1 and up.
+static unsigned pool_start(size_t len, unsigned nthreads) {
+    // pick the number of threads, and use just this one if there isn't
+    // enough data for more, or if the pool is in use
+    if (nthreads == 0) {
+        long procs = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = procs < 1 ? 1 : procs;
+    }
+    if (nthreads > CRC_THREADS_MAX)
+        nthreads = CRC_THREADS_MAX;
+    if (len / PAR_MIN < nthreads)
+        nthreads = len / PAR_MIN;
+    if (nthreads < 2 || pthread_mutex_trylock(&pool.use))
+        return 1;
+
+    // start more worker threads if needed -- if any can't be started, the
+    // jobs will be done by the threads there are
+    while (pool.threads < nthreads - 1 &&
+           pthread_create(pool.tid + pool.threads, NULL, worker, NULL) == 0)
+        pool.threads++;
+    pthread_mutex_lock(&pool.lock);
+    return nthreads;
+}
+
+// Hand out the nthreads - 1 jobs set up after pool_start() to the workers.
+static void pool_go(unsigned nthreads) {
+    pool.next = 1;
+    pool.jobs = nthreads;
+    pool.left = nthreads - 1;
+    pthread_cond_broadcast(&pool.work);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+// Help with the jobs handed out by pool_go(), wait for them all to be done,
+// and then combine their CRCs in order after crc, the CRC of job 0. Release
+// the pool and return the combined CRC.
+static word_t pool_finish(model_t *model, word_t crc, unsigned nthreads) {
+    pthread_mutex_lock(&pool.lock);
+    while (pool.next < pool.jobs)
+        take();
+    while (pool.left)
+        pthread_cond_wait(&pool.done, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+    for (unsigned k = 1; k < nthreads; k++)
+        crc = crc_combine(model, crc, pool.job[k].crc, pool.job[k].len);
+    pthread_mutex_unlock(&pool.use);
+    return crc;
+}
+
+word_t crc_parallel(model_t *model, word_t crc, void const *dat, size_t len,
+                    unsigned nthreads)
+{
+    unsigned char const *buf = dat;
+
+    // if requested, return the initial CRC
+    if (buf == NULL)
+        return model->init;
+
+    nthreads = pool_start(len, nthreads);
+    if (nthreads < 2)
+        return crc_fast(model, crc, buf, len);
+
+    // give jobs 1..nthreads-1 to the workers, each a multiple of 64 bytes,
+    // with the last job getting what's left
+    size_t size = (len / nthreads) & ~(size_t)63;
+    for (unsigned k = 1; k < nthreads; k++) {
+        job_t *job = pool.job + k;
+        job->model = model;
+        job->buf = buf + k * size;
+        job->iov = NULL;
+        job->len = k == nthreads - 1 ? len - k * size : size;
+    }
+    pool_go(nthreads);
+
+    // do job 0 here, continuing from crc, then combine with the other jobs
+    crc = crc_fast(model, crc, buf, size);
+    return pool_finish(model, crc, nthreads);
+}
+
+// Return the total length of the count segments at iov.
+static size_t iov_len(struct iovec const *iov, int count) {
+    size_t len = 0;
+    for (int i = 0; i < count; i++)
+        len += iov[i].iov_len;
+    return len;
+}
+
+word_t crc_iov(model_t *model, word_t crc, struct iovec const *iov, int count)
+{
+    // if requested, return the initial CRC
+    if (iov == NULL)
+        return model->init;
+    return iov_run(model, crc, iov, 0, iov_len(iov, count));
+}
+
+word_t crc_iov_parallel(model_t *model, word_t crc, struct iovec const *iov,
+                        int count, unsigned nthreads)
+{
+    // if requested, return the initial CRC
+    if (iov == NULL)
+        return model->init;
+
+    size_t len = iov_len(iov, count);
+    nthreads = pool_start(len, nthreads);
+    if (nthreads < 2)
+        return iov_run(model, crc, iov, 0, len);
+
+    // give jobs 1..nthreads-1 to the workers, as for crc_parallel(), each
+    // starting where the one before it ends, possibly inside a segment
+    size_t size = (len / nthreads) & ~(size_t)63, skip = size;
+    struct iovec const *at = iov;
+    for (unsigned k = 1; k < nthreads; k++) {
+        while (skip >= at->iov_len) {
+            skip -= at->iov_len;
+            at++;
+        }
+        job_t *job = pool.job + k;
+        job->model = model;
+        job->iov = at;
+        job->skip = skip;
+        job->len = k == nthreads - 1 ? len - k * size : size;
+        skip += size;
+    }
+    pool_go(nthreads);
+
+    // do job 0 here, continuing from crc, then combine with the other jobs
+    crc = iov_run(model, crc, iov, 0, size);
+    return pool_finish(model, crc, nthreads);
+}
+
+void crc_parallel_free(void) {
+    pthread_mutex_lock(&pool.use);
+    pthread_mutex_lock(&pool.lock);
+    pool.quit = 1;
+    pthread_cond_broadcast(&pool.work);
+    pthread_mutex_unlock(&pool.lock);
+    while (pool.threads)
+        pthread_join(pool.tid[--pool.threads], NULL);
+    pool.quit = 0;
+    pthread_mutex_unlock(&pool.use);
+}
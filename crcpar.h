@@ -0,0 +1,51 @@
+/* crcpar.h -- Parallel CRC calculation of a large buffer or chain of buffers
+ * Copyright (C) 2021 Mark Adler
+ * For conditions of distribution and use, see copyright notice in crcany.c.
+ */
+
+#ifndef _CRCPAR_H_
+#define _CRCPAR_H_
+
+#include <sys/uio.h>
+#include "model.h"
+
+/* Maximum number of threads used by crc_parallel() and crc_iov_parallel(),
+   including the calling thread. */
+#define CRC_THREADS_MAX 64
+
+/* Equivalent to crc_bitwise(), but split the data into one portion per thread
+   and compute the CRC of each portion at the same time using crc_fast(), then
+   combine the CRCs of the portions using crc_combine(). This assumes that
+   crc_table_fast() and crc_table_combine() have been called for the model.
+
+   nthreads is the maximum number of threads to use, including the calling
+   thread, or zero to use one thread per online processor. Each thread gets at
+   least a megabyte of data, so shorter lengths use fewer threads, with less
+   than two megabytes computed entirely by the calling thread. The worker
+   threads are created as needed, and are kept waiting for the next call, so
+   that they are created only once. The pool of worker threads is used by one
+   crc_parallel() call at a time -- a call made while another call is using
+   the pool computes its CRC in the calling thread. */
+word_t crc_parallel(model_t *, word_t, void const *, size_t, unsigned);
+
+/* Equivalent to crc_bitwise() on the concatenation of the data in the count
+   segments at iov, without copying them. Runs of short segments are computed
+   with the streaming word-wise calculation of crc_ctx_update(), so that a
+   word that straddles segments is still processed as one word, and long
+   segments are computed with crc_fast(). This assumes that crc_table_fast()
+   has been called for the model. */
+word_t crc_iov(model_t *, word_t, struct iovec const *, int);
+
+/* Equivalent to crc_iov(), but split the data into one portion per thread
+   and compute them at the same time as for crc_parallel(), including the
+   use of nthreads and the minimum amount of data per thread. The portions
+   can begin and end inside of segments. This assumes that crc_table_fast()
+   and crc_table_combine() have been called for the model. */
+word_t crc_iov_parallel(model_t *, word_t, struct iovec const *, int,
+                        unsigned);
+
+/* Stop and free the worker threads created by crc_parallel(). crc_parallel()
+   can still be used after this, and will create new threads as needed. */
+void crc_parallel_free(void);
+
+#endif
@@ -35,6 +35,397 @@
 #include "model.h"
 #include "crc.h"
 #include "crcdbl.h"
+#include "crcpar.h"
+
+// Names of the tests in the tests bit vector in main(), in bit order. Bit 2
+// is set if the CRC is too long for the table-driven tests.
+static char const *const test_name[] = {
+    "bit", "residue", "long", "byte", "word", "combine", "clmul", "braid",
+    "hardware", "fast", "parallel", "zeros", "shared", "lazy",
+    "stream", "iov", "copy", "batch", "multi"
+};
+
+// All of the tests for a CRC that fits in a word_t.
+#define ALLTESTS (1 + 2 + 8 + 16 + 32 + 64 + 128 + 256 + 512 + 1024 + 2048 + \
+                  4096 + 8192 + 16384 + 32768 + 65536 + 131072 + \
+                  262144)
+
+// The tests for a CRC that is too long for a word_t.
+#define LONGTESTS (1 + 2 + 8 + 16 + 2048)
+
+// Length of the data for the parallel test, enough for four threads.
+#define BIG (5 * 1048576 + 12345)
+
+// Print the names of the tests in want that failed in tests, after name.
+static void print_fails(char const *name, unsigned tests, unsigned want) {
+    char const *sep = "";
+    printf("%s:", name);
+    for (unsigned k = 0; want >> k; k++)
+        if (((want & ~tests) >> k) & 1) {
+            printf("%s %s fail", sep, test_name[k]);
+            sep = ",";
+        }
+}
+
+// Verify the word-wise calculation with 2, 4, ... words of slices, up to 64
+// bytes, against the bit-wise calculation over a range of lengths and
+// alignments of data. Return true if all good. model->table_word is left with
+// WORDCHARS slices.
+static int test_slices(model_t *model, unsigned little,
+                       unsigned char const *data) {
+    int ok = 1;
+    for (unsigned slices = WORDCHARS << 1; ok && slices <= 64; slices <<= 1) {
+        if (crc_table_wordwise(model, little, WORDBITS, slices))
+            return 0;
+        for (unsigned k = 0; ok && k < 16; k++) {
+            size_t n = 100 + 41 * k;
+            ok = crc_wordwise(model, model->init, data + k, n) ==
+                 crc_bitwise(model, model->init, data + k, n);
+        }
+    }
+    return crc_table_wordwise(model, little, WORDBITS, WORDCHARS) == 0 && ok;
+}
+
+// Get the word-wise tables for the model from the shared registry, and verify
+// the byte-wise and word-wise calculations with them against the check value
+// and the bit-wise calculation. Also verify that the tables are the same as
+// those of the previous models with the same width, polynomial, and
+// reflection, and different from those of all of the others. Return true if
+// all good.
+static int test_shared(model_t *model, unsigned little,
+                       unsigned char const *data) {
+    static struct {
+        word_t poly;
+        unsigned width;
+        int ref;
+        void const *table;
+    } seen[512];
+    static unsigned num = 0;
+    static unsigned char const test[] = "123456789";
+
+    if (crc_table_shared(model, little, WORDBITS, WORDCHARS) ||
+        !model->table_shared ||
+        crc_bytewise(model, model->init, test, 9) != model->check ||
+        crc_wordwise(model, model->init, test, 9) != model->check)
+        return 0;
+    for (unsigned k = 0; k < 16; k++) {
+        size_t n = 100 + 41 * k;
+        if (crc_wordwise(model, model->init, data + k, n) !=
+            crc_bitwise(model, model->init, data + k, n))
+            return 0;
+    }
+    for (unsigned i = 0; i < num; i++)
+        if ((seen[i].width == model->width && seen[i].poly == model->poly &&
+             seen[i].ref == model->ref) != (seen[i].table == model->table_word))
+            return 0;
+    if (num < sizeof(seen) / sizeof(seen[0])) {
+        seen[num].poly = model->poly;
+        seen[num].width = model->width;
+        seen[num].ref = model->ref;
+        seen[num].table = model->table_word;
+        num++;
+    }
+    return 1;
+}
+
+// Verify crc_lazy() against the bit-wise calculation on a copy of the model
+// with no tables, with many short messages, then enough data to get the
+// word-wise tables, and then a message long enough to get the fast tables
+// right away, checking that each tier is entered when it should be. len bytes
+// of data are available, which must be at least LAZY_FAST. Return true if all
+// good.
+static int test_lazy(model_t const *model, unsigned char const *data,
+                     size_t len) {
+    model_t lazy = *model;
+    lazy.name = NULL;
+    clear_model(&lazy);
+    int ok = crc_table_lazy(&lazy) == 0 && lazy.tier == 0;
+    word_t crc = crc_lazy(&lazy, 0, NULL, 0), want = crc;
+    size_t at = 0;
+    while (ok && at + 20 <= LAZY_WORD) {
+        crc = crc_lazy(&lazy, crc, data + at, 20);
+        want = crc_bitwise(&lazy, want, data + at, 20);
+        ok = crc == want && lazy.tier == 1 && lazy.table_word == NULL;
+        at += 20;
+    }
+    if (ok) {
+        crc = crc_lazy(&lazy, crc, data + at, 1000);
+        want = crc_bitwise(&lazy, want, data + at, 1000);
+        ok = crc == want && lazy.tier == 2 && lazy.table_byte == NULL;
+    }
+    if (ok) {
+        crc = crc_lazy(&lazy, lazy.init, data, len);
+        ok = lazy.tier == 3 && crc == crc_bitwise(&lazy, lazy.init, data, len);
+    }
+    free_model(&lazy);
+    return ok;
+}
+
+// Verify the streaming calculation against the bit-wise calculation, feeding
+// it len bytes of data in pieces of zero to 100 bytes, and getting the CRC
+// along the way. This assumes that the word-wise tables have been built.
+// Return true if all good.
+static int test_stream(model_t *model, unsigned char const *data,
+                       size_t len) {
+    crc_ctx_t ctx;
+    crc_ctx_init(&ctx, model, model->init);
+    if (crc_ctx_final(&ctx) != model->init)
+        return 0;
+    word_t want = model->init;
+    uint64_t ran = 1;
+    size_t at = 0;
+    while (at < len) {
+        ran = ran * 6364136223846793005 + 1442695040888963407;
+        size_t n = (ran >> 33) % 101;
+        if (n > len - at)
+            n = len - at;
+        crc_ctx_update(&ctx, data + at, n);
+        want = crc_bitwise(model, want, data + at, n);
+        at += n;
+        if ((ran >> 40) % 7 == 0 && crc_ctx_final(&ctx) != want)
+            return 0;
+    }
+    crc_ctx_update(&ctx, data, len);
+    want = crc_bitwise(model, want, data, len);
+    return crc_ctx_final(&ctx) == want;
+}
+
+// Verify crc_iov() and crc_iov_parallel() against crc_fast() on len bytes of
+// data, continuing from crc, split into a chain of segments of mostly zero to
+// 300 bytes, with some long ones, and four threads for the parallel
+// calculation. This assumes that the tables for crc_fast() and crc_combine()
+// have been built. Return true if all good. If out of memory, say so and
+// return false, so that a test that could not be run is not counted as passed.
+static int test_iov(model_t *model, word_t crc, unsigned char const *data,
+                    size_t len) {
+    struct iovec *iov = NULL;
+    int count = 0, max = 0;
+    uint64_t ran = 1;
+    size_t at = 0;
+    while (at < len) {
+        if (count == max) {
+            max = max ? max << 1 : 1024;
+            void *mem = realloc(iov, max * sizeof(struct iovec));
+            if (mem == NULL) {
+                fputs("out of memory -- iov test not run\n", stderr);
+                free(iov);
+                return 0;
+            }
+            iov = mem;
+        }
+        ran = ran * 6364136223846793005 + 1442695040888963407;
+        size_t n = count % 64 == 63 ? 20000 + (ran >> 33) % 64000 :
+                                      (ran >> 33) % 301;
+        if (n > len - at)
+            n = len - at;
+        iov[count].iov_base = (void *)(uintptr_t)(data + at);
+        iov[count++].iov_len = n;
+        at += n;
+    }
+    word_t want = crc_fast(model, crc, data, len);
+    int ok = crc_iov(model, 0, NULL, 0) == model->init &&
+             crc_iov(model, crc, iov, 0) == crc &&
+             crc_iov(model, crc, iov, count) == want &&
+             crc_iov_parallel(model, crc, iov, count, 4) == want;
+    free(iov);
+    return ok;
+}
+
+// Verify crc_copy() against crc_fast() and the copied data against the
+// original, for lengths and offsets in src and dst that put the words at
+// every alignment, and for all len bytes of data at once, which is long
+// enough for non-temporal stores. dst must have room for len + WORDCHARS
+// bytes. This assumes that the tables for crc_fast() have been built. Return
+// true if all good.
+static int test_copy(model_t *model, word_t crc, unsigned char *dst,
+                     unsigned char const *data, size_t len) {
+    for (unsigned k = 0; k < 32; k++) {
+        size_t n = 1000 + 37 * k;
+        unsigned char *to = dst + (k * 3) % WORDCHARS;
+        if (crc_copy(model, crc, to, data + k, n) !=
+                crc_fast(model, crc, data + k, n) ||
+            memcmp(to, data + k, n))
+            return 0;
+    }
+    return crc_copy(model, 0, dst, NULL, 0) == model->init &&
+           crc_copy(model, crc, dst + 1, data, len) ==
+               crc_fast(model, crc, data, len) &&
+           memcmp(dst + 1, data, len) == 0;
+}
+
+// Verify crc_batch() against the bit-wise calculation, for 200 messages from
+// data of zero to 300 bytes each, half of them continuing from a CRC other
+// than the initial CRC. len must be at least 300. This assumes that the
+// word-wise tables have been built. Return true if all good.
+static int test_batch(model_t *model, unsigned char const *data, size_t len) {
+    void const *bufs[200];
+    size_t lens[200];
+    word_t crcs[200], want[200];
+    uint64_t ran = 1;
+    for (unsigned i = 0; i < 200; i++) {
+        ran = ran * 6364136223846793005 + 1442695040888963407;
+        lens[i] = (ran >> 33) % 301;
+        bufs[i] = data + (ran >> 20) % (len - lens[i] + 1);
+        crcs[i] = i & 1 ? crc_bitwise(model, model->init, data, i) :
+                          model->init;
+        want[i] = crc_bitwise(model, crcs[i], bufs[i], lens[i]);
+    }
+    crc_batch(model, bufs, lens, crcs, 200);
+    for (unsigned i = 0; i < 200; i++)
+        if (crcs[i] != want[i])
+            return 0;
+    return 1;
+}
+
+// Verify crc_multi() against crc_fast() for model, CRC-64/XZ, and model again
+// continuing from crc, on len bytes of data. This assumes that the tables for
+// crc_fast() have been built for model. Return true if all good.
+static int test_multi(model_t *model, word_t crc, unsigned char const *data,
+                      size_t len) {
+    char def[] = "w=64 p=0x42f0e1eba9ea3693 i=0xffffffffffffffff r=t "
+                 "x=0xffffffffffffffff n=XZ";
+    model_t xz;
+    if (read_model(&xz, def, 1))
+        return 0;
+    process_model(&xz);
+    int ok = crc_table_fast(&xz) == 0;
+    if (ok) {
+        model_t *const models[] = {model, &xz, model};
+        word_t crcs[] = {model->init, xz.init, crc};
+        crc_multi(models, crcs, 3, data, len);
+        ok = crcs[0] == crc_fast(model, model->init, data, len) &&
+             crcs[1] == crc_fast(&xz, xz.init, data, len) &&
+             crcs[2] == crc_fast(model, crc, data, len);
+    }
+    free_model(&xz);
+    return ok;
+}
+
+// Verify the hardware calculation against the bit-wise calculation for
+// CRC-32C with init and xorout values different from those of any catalogued
+// model. len bytes of data are used. Return true if all good.
+static int test_hw_variant(unsigned char const *data, size_t len) {
+    char def[] = "w=32 p=0x1edc6f41 i=0x2a05f7c1 r=t x=0x5d3c9e61 n=VARIANT";
+    model_t model;
+    if (read_model(&model, def, 1))
+        return 0;
+    process_model(&model);
+    unsigned little = 1;
+    little = *((unsigned char *)(&little));
+    int ok = crc_table_wordwise(&model, little, WORDBITS, WORDCHARS) == 0 &&
+             crc_table_hardware(&model);
+    for (size_t n = 0; ok && n <= len; n += n < 64 ? 1 : 4093)
+        ok = crc_hardware(&model, model.init, data, n) ==
+             crc_bitwise(&model, model.init, data, n);
+    free_model(&model);
+    return ok;
+}
+
+// Verify the byte-wise and word-wise calculations for a CRC longer than a
+// word_t with the check value, and against the bit-wise calculation over a
+// range of lengths and alignments of data. Return the tests bits for byte-wise
+// (8) and word-wise (16) that passed.
+static unsigned test_dbl(model_t *model, unsigned char const *data) {
+    static unsigned char const test[] = "123456789";
+    unsigned tests = 0;
+    if (crc_table_dbl(model))
+        return 0;
+    word_t hi, lo, bit_hi, bit_lo;
+    crc_bytewise_dbl(model, &hi, &lo, NULL, 0);
+    crc_bytewise_dbl(model, &hi, &lo, test, 9);
+    if (hi == model->check_hi && lo == model->check)
+        tests |= 8;
+    crc_wordwise_dbl(model, &hi, &lo, NULL, 0);
+    crc_wordwise_dbl(model, &hi, &lo, test, 9);
+    if (hi == model->check_hi && lo == model->check)
+        tests |= 16;
+    for (unsigned k = 0; tests && k < 16; k++) {
+        size_t n = 100 + 41 * k;
+        bit_hi = hi = model->init_hi;
+        bit_lo = lo = model->init;
+        crc_bitwise_dbl(model, &bit_hi, &bit_lo, data + k, n);
+        crc_bytewise_dbl(model, &hi, &lo, data + k, n);
+        if (hi != bit_hi || lo != bit_lo)
+            tests &= ~8U;
+        hi = model->init_hi;
+        lo = model->init;
+        crc_wordwise_dbl(model, &hi, &lo, data + k, n);
+        if (hi != bit_hi || lo != bit_lo)
+            tests &= ~16U;
+    }
+    return tests;
+}
+
+// Verify crc_zeros_dbl_fast() against crc_zeros_dbl() for a range of counts,
+// including those that are not a multiple of eight bits, and check that
+// appending very long runs of zeros is associative. For a model that fits in a
+// word_t, this assumes that crc_table_combine() has been called. Return true
+// if all good.
+static int test_zeros(model_t *model) {
+    for (uintmax_t k = 0; k < 24; k++) {
+        word_t hi = model->check_hi, lo = model->check;
+        word_t fast_hi = hi, fast_lo = lo;
+        crc_zeros_dbl(model, &hi, &lo, k * k * k + k);
+        crc_zeros_dbl_fast(model, &fast_hi, &fast_lo, k * k * k + k);
+        if (hi != fast_hi || lo != fast_lo)
+            return 0;
+    }
+    uint64_t ran = 1;
+    for (int j = 0; j < 8; j++) {
+        ran = ran * 6364136223846793005 + 1442695040888963407;
+        uintmax_t count1 = ran >> (1 + j * 5);
+        ran = ran * 6364136223846793005 + 1442695040888963407;
+        uintmax_t count2 = ran >> (1 + j * 3);
+        word_t hi = model->check_hi, lo = model->check;
+        word_t sum_hi = hi, sum_lo = lo;
+        crc_zeros_dbl_fast(model, &hi, &lo, count1);
+        crc_zeros_dbl_fast(model, &hi, &lo, count2);
+        crc_zeros_dbl_fast(model, &sum_hi, &sum_lo, count1 + count2);
+        if (hi != sum_hi || lo != sum_lo)
+            return 0;
+    }
+    return 1;
+}
+
+// Verify the byte-wise and word-wise calculations and crc_zeros_dbl_fast() on
+// CRCs longer than a word_t that are not in the catalogue, using test_dbl()
+// and test_zeros(): non-reflected, reflected, and reflected only on input, of
+// 96 bits and of the full two words, where there are no spare bits in the
+// double word. The check value of each is computed bit-wise. Return the tests
+// bits for byte-wise (8), word-wise (16), and zeros (2048) that passed for
+// all of them. The 128-bit variants need a double word of at least 128 bits,
+// so this is only called when 2 * WORDBITS >= 128.
+static unsigned test_dbl_variants(unsigned char const *data) {
+    static char const *const defs[] = {
+        "w=96 p=0x2b9c4f31e5a7d8c160f3b59d i=0x5a0f3c96e1d24b78a5c3f069"
+            " r=f x=0x0123456789abcdef76543210 n=VARIANT-96",
+        "w=128 p=0x1b4c8f0e3a9d2c7b6e5f4a3928170615"
+            " i=0xf0e1d2c3b4a5968778695a4b3c2d1e0f r=f"
+            " x=0x89abcdef0123456776543210fedcba98 n=VARIANT-128",
+        "w=128 p=0xa8b3c2d1e0f9a8b7c6d5e4f3a2b1c0d9"
+            " i=0x0f1e2d3c4b5a69788796a5b4c3d2e1f0 r=t"
+            " x=0x76543210fedcba9889abcdef01234567 n=VARIANT-128R",
+        "w=96 p=0x6d1f0b83c5e7a9420b1d3f59 i=0x3c2d1e0f5a4b6978a5968778"
+            " refin=t refout=f x=0xfedcba987654321001234567 n=VARIANT-96X"
+    };
+    static unsigned char const test[] = "123456789";
+    unsigned tests = 8 | 16 | 2048;
+    for (size_t i = 0; i < sizeof(defs) / sizeof(defs[0]); i++) {
+        char def[160];
+        strcpy(def, defs[i]);
+        model_t model;
+        if (read_model(&model, def, 1))
+            return 0;
+        process_model(&model);
+        crc_bitwise_dbl(&model, &model.check_hi, &model.check, NULL, 0);
+        crc_bitwise_dbl(&model, &model.check_hi, &model.check, test, 9);
+        tests &= test_dbl(&model, data) | 2048;
+        if (!test_zeros(&model))
+            tests &= ~2048U;
+        free_model(&model);
+    }
+    return tests;
+}
 
 // --- Test on model input from stdin ---
 
@@ -47,6 +438,10 @@ int main(void) {
     unsigned tests;
     unsigned inval = 0, num = 0, good = 0, goodres = 0;
     unsigned numall = 0, goodbyte = 0, goodword = 0, goodcomb = 0;
+    unsigned goodclmul = 0, goodbraid = 0, goodhw = 0, numhw = 0;
+    unsigned goodfast = 0, goodpar = 0, goodzeros = 0, goodshared = 0;
+    unsigned goodlazy = 0, goodstream = 0, goodiov = 0, goodcopy = 0;
+    unsigned goodbatch = 0, goodmulti = 0;
     char *line = NULL;
     size_t size;
     ptrdiff_t len;
@@ -81,6 +476,22 @@ int main(void) {
             random_data[--n] = rand() >> shft;
         } while (n);
     }
+    unsigned char *big = malloc(BIG);   // long data for parallel test
+    if (big == NULL) {
+        fputs("out of memory -- aborting\n", stderr);
+        return 1;
+    }
+    for (size_t n = 0; n < BIG; n += sizeof(random_data)) {
+        size_t k = BIG - n < sizeof(random_data) ? BIG - n :
+                                                   sizeof(random_data);
+        memcpy(big + n, random_data, k);
+        big[n] ^= n >> 16;              // make the copies differ
+    }
+    unsigned char *dst = malloc(BIG + WORDCHARS);   // for the copy test
+    if (dst == NULL) {
+        fputs("out of memory -- aborting\n", stderr);
+        return 1;
+    }
     model.name = NULL;
     while ((len = getcleanline(&line, &size, stdin)) != -1) {
         if (len == 0)
@@ -114,91 +525,300 @@ int main(void) {
                 tests |= 2;
                 goodres++;
             }
-            if (model.width > WORDBITS)
+            if (model.width > WORDBITS) {
                 tests |= 4;
+
+                // byte-wise and word-wise using double-word tables, on this
+                // model and on the variants that the catalogue does not have --
+                // if the variants can't be run, then those checks are left
+                // unset rather than counted as passed
+                unsigned dbl = 2 * WORDBITS < 128 ? 0 :
+                               test_dbl_variants(random_data);
+                tests |= test_dbl(&model, random_data) & dbl;
+                if (tests & 8)
+                    goodbyte++;
+                if (tests & 16)
+                    goodword++;
+
+                if ((dbl & 2048) && test_zeros(&model)) {
+                    tests |= 2048;
+                    goodzeros++;
+                }
+            }
             else {
-                // initialize tables for byte-wise and word-wise
+                // byte-wise, first with only the byte-wise table, and then
+                // with the narrow copy stored with the word-wise tables
                 unsigned little = 1;
                 little = *((unsigned char *)(&little));
-                crc_table_wordwise(&model, little, WORDBITS);
-
-                // byte-wise
+                crc_table_bytewise(&model);
+                word_t byte = crc_bytewise(&model, 0, NULL, 0);
+                byte = crc_bytewise(&model, byte, test, 9);
+                crc_table_wordwise(&model, little, WORDBITS, WORDCHARS);
                 crc = crc_bytewise(&model, 0, NULL, 0);
                 crc = crc_bytewise(&model, crc, test, 9);
-                if (crc == model.check) {
+                if (byte == model.check && crc == model.check) {
                     tests |= 8;
                     goodbyte++;
                 }
 
                 // word-wise (check on and off boundary in order to exercise
-                // all loops)
+                // all loops, and with more slices)
                 crc = crc_wordwise(&model, 0, NULL, 0);
                 crc = crc_wordwise(&model, crc, test, 9);
                 if (crc == model.check) {
                     crc = crc_wordwise(&model, 0, NULL, 0);
                     crc = crc_wordwise(&model, crc, test + 15, 9);
-                    if (crc == model.check) {
+                    if (crc == model.check &&
+                        test_slices(&model, little, random_data)) {
                         tests |= 16;
                         goodword++;
                     }
                 }
                 numall++;
 
-                // combine
+                // streaming (pieces of many lengths and alignments)
+                if (test_stream(&model, random_data, 4000)) {
+                    tests |= 16384;
+                    goodstream++;
+                }
+
+                // batch (many messages at once, compare to bit-wise)
+                if (test_batch(&model, random_data, sizeof(random_data))) {
+                    tests |= 131072;
+                    goodbatch++;
+                }
+
+                // shared (the remaining tests use the shared tables)
+                if (test_shared(&model, little, random_data)) {
+                    tests |= 4096;
+                    goodshared++;
+                }
+
+                // combine (at several split points, and check that combining
+                // is associative for very long lengths, using all of the
+                // powers of x)
                 crc_table_combine(&model);
                 size_t len = sizeof(random_data);
-                size_t len2 = 61417;
-                size_t len1 = sizeof(random_data) - len2;
-                crc = crc_bytewise(&model, 0, NULL, 0);
-                word_t crc1 = crc, crc2 = crc;
-                crc = crc_bytewise(&model, crc, random_data, len);
-                crc1 = crc_bytewise(&model, crc1, random_data, len1);
-                crc2 = crc_bytewise(&model, crc2, random_data + len1, len2);
-                if (crc == crc_combine(&model, crc1, crc2, len2)) {
+                crc = crc_bytewise(&model, model.init, random_data, len);
+                unsigned k = 0;
+                do {
+                    size_t len2 = k ? (61417 * k) % len : 0;
+                    size_t len1 = len - len2;
+                    word_t crc1 = crc_bytewise(&model, model.init,
+                                               random_data, len1);
+                    word_t crc2 = crc_bytewise(&model, model.init,
+                                               random_data + len1, len2);
+                    if (crc != crc_combine(&model, crc1, crc2, len2))
+                        break;
+                } while (++k < 8);
+                unsigned j = 0;
+                uint64_t ran = 1;
+                while (k == 8 && j < 32) {
+                    ran = ran * 6364136223846793005 + 1442695040888963407;
+                    uintmax_t big2 = ran >> (1 + j % 48);
+                    ran = ran * 6364136223846793005 + 1442695040888963407;
+                    uintmax_t big3 = ran >> (1 + j % 40);
+                    word_t crc2 = crc_combine(&model, crc, crc, big3);
+                    if (crc_combine(&model,
+                                    crc_combine(&model, crc, crc, big2),
+                                    crc2, big3) !=
+                        crc_combine(&model, crc,
+                                    crc_combine(&model, crc, crc2, big3),
+                                    big2 + big3))
+                        break;
+                    j++;
+                }
+                if (j == 32) {
                     tests |= 32;
                     goodcomb++;
                 }
+
+                // logarithmic zeros (uses the combine tables)
+                if (test_zeros(&model)) {
+                    tests |= 2048;
+                    goodzeros++;
+                }
+
+                // carry-less multiply (compare to bit-wise over a range of
+                // lengths and alignments, to exercise the folding and the
+                // leftover bytes)
+                crc_table_clmul(&model);
+                crc = crc_clmul(&model, 0, NULL, 0);
+                if (crc_clmul(&model, crc, test, 9) == model.check) {
+                    unsigned k = 0;
+                    do {
+                        size_t n = 1000 + 37 * k;
+                        word_t want = crc_bitwise(&model, model.init,
+                                                  random_data + k, n);
+                        if (crc_clmul(&model, crc, random_data + k, n) !=
+                                want ||
+                            crc_clmul512(&model, crc, random_data + k, n) !=
+                                want)
+                            break;
+                    } while (++k < 32);
+                    if (k == 32) {
+                        tests |= 64;
+                        goodclmul++;
+                    }
+                }
+
+                // braided (compare to bit-wise over a range of lengths and
+                // alignments, from too short to braid to many blocks)
+                crc_table_braid(&model, little);
+                crc = crc_braid(&model, 0, NULL, 0);
+                if (crc_braid(&model, crc, test, 9) == model.check) {
+                    unsigned k = 0;
+                    do {
+                        size_t n = 50 + 23 * k;
+                        if (crc_braid(&model, crc, random_data + k, n) !=
+                            crc_bitwise(&model, model.init,
+                                        random_data + k, n))
+                            break;
+                    } while (++k < 32);
+                    if (k == 32) {
+                        tests |= 128;
+                        goodbraid++;
+                    }
+                }
+
+                // hardware (compare to bit-wise over a range of lengths and
+                // alignments, and the whole random data to use the long
+                // streams -- models other than CRC-32C use word-wise)
+                int hw = crc_table_hardware(&model);
+                crc = crc_hardware(&model, 0, NULL, 0);
+                if (crc_hardware(&model, crc, test, 9) == model.check &&
+                    crc_hardware(&model, crc, random_data,
+                                 sizeof(random_data)) ==
+                        crc_bitwise(&model, model.init, random_data,
+                                    sizeof(random_data)) &&
+                    (!hw || test_hw_variant(random_data,
+                                            sizeof(random_data)))) {
+                    unsigned k = 0;
+                    do {
+                        size_t n = 1000 + 37 * k;
+                        if (crc_hardware(&model, crc, random_data + k, n) !=
+                            crc_bitwise(&model, model.init,
+                                        random_data + k, n))
+                            break;
+                    } while (++k < 32);
+                    if (k == 32) {
+                        tests |= 256;
+                        goodhw++;
+                    }
+                }
+                numhw += hw;
+
+                // fast (compare to bit-wise over lengths in all of the
+                // length classes)
+                if (crc_table_fast(&model) == 0) {
+                    crc = crc_fast(&model, 0, NULL, 0);
+                    unsigned k = 0;
+                    do {
+                        size_t n = 13 * k * k;
+                        if (crc_fast(&model, crc, random_data + k, n) !=
+                            crc_bitwise(&model, model.init,
+                                        random_data + k, n))
+                            break;
+                    } while (++k < 32);
+                    if (k == 32 && crc_fast(&model, crc, test, 9) ==
+                                       model.check) {
+                        tests |= 512;
+                        goodfast++;
+                    }
+
+                    // parallel (compare to fast, continuing from a CRC, on
+                    // enough data for four threads)
+                    crc = crc_fast(&model, crc, test, 9);
+                    if (crc_parallel(&model, crc, big, BIG, 4) ==
+                        crc_fast(&model, crc, big, BIG)) {
+                        tests |= 1024;
+                        goodpar++;
+                    }
+
+                    // iov (compare to fast, on the same data in segments)
+                    if (test_iov(&model, crc, big, BIG)) {
+                        tests |= 32768;
+                        goodiov++;
+                    }
+
+                    // copy (compare to fast, and the copy to the data)
+                    if (test_copy(&model, crc, dst, big, BIG)) {
+                        tests |= 65536;
+                        goodcopy++;
+                    }
+
+                    // multi (compare to fast, with another model)
+                    if (test_multi(&model, crc, big, BIG)) {
+                        tests |= 262144;
+                        goodmulti++;
+                    }
+                }
+
+                // lazy (starting from no tables, for each tier)
+                if (test_lazy(&model, big, LAZY_FAST)) {
+                    tests |= 8192;
+                    goodlazy++;
+                }
             }
             num++;
-            if (tests & 4)
-                printf("%s:%s%s%s (CRC too long for byte, word)\n",
-                       model.name,
-                       tests & 1 ? "" : " bit fail",
-                       tests & 3 ? "" : ",",
-                       tests & 2 ? "" : " residue fail");
+            if (tests & 4) {
+                print_fails(model.name, tests, LONGTESTS);
+                puts(" (CRC longer than a word_t)");
+            }
             else if (tests == 0)
                 printf("%s: all tests failed\n", model.name);
-            else if (tests != 1 + 2 + 8 + 16 + 32)
-                printf("%s:%s%s%s%s%s%s%s%s%s\n",
-                       model.name,
-                       tests & 1 ? "" : " bit fail",
-                       tests & 3 ? "" : ",",
-                       tests & 2 ? "" : " residue fail",
-                       (tests & 3) == 3 || (tests & 8) ? "" : ",",
-                       tests & 8 ? "" : " byte fail",
-                       (tests & 11) == 11 || (tests & 16) ? "" : ",",
-                       tests & 16 ? "" : " word fail",
-                       (tests & 27) || (tests & 32) ? "" : ",",
-                       tests & 32 ? "" : " combine fail");
+            else if (tests != ALLTESTS) {
+                print_fails(model.name, tests, ALLTESTS);
+                putchar('\n');
+            }
         }
-        free(model.name);
-        model.name = NULL;
+        free_model(&model);
     }
     free(line);
+    crc_parallel_free();
+    crc_shared_free();
+    free(dst);
+    free(big);
     free(test);
     printf("%u models verified bit-wise out of %u usable "
            "(%u unusable models)\n", good, num, inval);
     printf("%u model residues verified out of %u usable "
            "(%u unusable models)\n", goodres, num, inval);
     printf("%u models verified byte-wise out of %u usable\n",
-           goodbyte, numall);
+           goodbyte, num);
     crc = 1;
     printf("%u models verified word-wise out of %u usable (%s-endian)\n",
-           goodword, numall, *((unsigned char *)(&crc)) ? "little" : "big");
+           goodword, num, *((unsigned char *)(&crc)) ? "little" : "big");
     printf("%u models verified combine out of %u usable\n",
            goodcomb, numall);
-    puts(good == num && goodres == num && goodbyte == numall &&
-         goodword == numall && goodcomb == numall ?
+    printf("%u models verified carry-less multiply out of %u usable\n",
+           goodclmul, numall);
+    printf("%u models verified braided out of %u usable\n",
+           goodbraid, numall);
+    printf("%u models verified hardware out of %u usable (%u CRC-32C)\n",
+           goodhw, numall, numhw);
+    printf("%u models verified fast out of %u usable (cpu features %#x)\n",
+           goodfast, numall, crc_cpu());
+    printf("%u models verified parallel out of %u usable\n",
+           goodpar, numall);
+    printf("%u models verified zeros out of %u usable\n", goodzeros, num);
+    printf("%u models verified shared out of %u usable\n",
+           goodshared, numall);
+    printf("%u models verified lazy out of %u usable\n", goodlazy, numall);
+    printf("%u models verified streaming out of %u usable\n",
+           goodstream, numall);
+    printf("%u models verified iov out of %u usable\n", goodiov, numall);
+    printf("%u models verified copy out of %u usable\n", goodcopy, numall);
+    printf("%u models verified batch out of %u usable\n", goodbatch, numall);
+    printf("%u models verified multi out of %u usable\n", goodmulti, numall);
+    puts(good == num && goodres == num && goodbyte == num &&
+         goodword == num && goodcomb == numall && goodclmul == numall &&
+         goodbraid == numall && goodhw == numall &&
+         goodfast == numall && goodpar == numall && goodzeros == num &&
+         goodshared == numall && goodlazy == numall &&
+         goodstream == numall && goodiov == numall &&
+         goodcopy == numall && goodbatch == numall &&
+         goodmulti == numall ?
             "-- all good" : "** verification failed");
     return 0;
 }
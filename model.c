@@ -248,6 +248,7 @@ int read_model(model_t *model, char *str, int lenient)
     got = bad = rep = 0;
     unk = NULL;
     model->name = NULL;
+    clear_model(model);
     while ((ret = read_var(&str, &name, &value)) == 1) {
         n = strlen(name);
         k = strlen(value);
@@ -395,6 +396,7 @@ int read_model(model_t *model, char *str, int lenient)
     }
     if (lenient && (got & CHECK) == 0) {
         model->check = 0;
+        model->check_hi = 0;
         got |= CHECK;
     }
 
@@ -449,6 +451,37 @@ int read_model(model_t *model, char *str, int lenient)
     return 0;
 }
 
+/* See model.h. */
+void clear_model(model_t *model)
+{
+    model->table_byte = NULL;
+    model->table_word = NULL;
+    model->table_shared = 0;
+    model->table_braid = NULL;
+    model->table_comb = NULL;
+    model->table_pow = NULL;
+    model->table_dbl = NULL;
+    model->tier = 0;
+    model->seen = 0;
+    for (unsigned k = 0; k < CRC_CLASSES; k++)
+        model->fast[k] = NULL;
+}
+
+/* See model.h. */
+void free_model(model_t *model)
+{
+    free(model->name);
+    free(model->table_byte);
+    if (!model->table_shared)
+        free(model->table_word);
+    free(model->table_braid);
+    free(model->table_comb);
+    free(model->table_pow);
+    free(model->table_dbl);
+    model->name = NULL;
+    clear_model(model);
+}
+
 /* See model.h. */
 word_t reverse(word_t x, unsigned n)
 {
@@ -48,6 +48,14 @@ typedef uintmax_t word_t;
 /* Mask for the low n bits of a word_t (n must be greater than zero). */
 #define ONES(n) (((word_t)0 - 1) >> (WORDBITS - (n)))
 
+struct model_s;
+
+/* Type of a CRC calculation routine, e.g. crc_wordwise(). */
+typedef word_t crc_func_t(struct model_s *, word_t, void const *, size_t);
+
+/* Number of length classes for which crc_table_fast() selects a routine. */
+#define CRC_CLASSES 3
+
 /* CRC description and tables, allowing for double-word CRCs.
 
    The description is based on Ross William's parameters, but with some changes
@@ -65,13 +73,42 @@ typedef uintmax_t word_t;
 
    poly is reflected for refin true.  xorout is reflected for refout true.
 
-   The structure includes space for pre-computed CRC tables used to speed up
-   the CRC calculation.  Both are filled in by the crc_table_wordwise()
-   routine, using the CRC parameters already defined in the structure. */
-typedef struct {
+   The structure is only the description of the CRC, along with a few small
+   constants and pointers to pre-computed CRC tables used to speed up the CRC
+   calculation.  Each table is allocated by the routine that fills it in, using
+   the CRC parameters already defined in the structure, so that a model only
+   takes the space for the tables that are used.  All of the tables are freed
+   by free_model().  The byte-wise table is filled in by crc_table_bytewise(),
+   and the word-wise tables by crc_table_wordwise().  The word-wise tables,
+   followed by a copy of the byte-wise table, are stored in the narrowest
+   unsigned integer type that can hold the CRC, of table_bytes bytes, and are
+   shifted down by table_shift bits, so that a short CRC does not take eight
+   bytes per entry.  They were built for the endianess table_little and the
+   word size table_bits, with no initial or final exclusive-or.  table_top is
+   the shift that puts a CRC at the top of a word for those tables.  If
+   table_shared is true, then they were obtained from crc_table_shared() or
+   crc_map_model(), are shared with other models, and must not be modified or
+   freed.  The braid tables are filled in by crc_table_braid(), and the
+   combination tables by crc_table_combine().  The constants for the
+   carry-less multiply calculation are filled in by crc_table_clmul(), and
+   those for the hardware CRC-32C calculation by crc_table_hardware().
+   crc_table_fast() fills in the tables usable on the processor being run on,
+   and sets fast[] to the fastest CRC routines for short, medium, and long
+   inputs.  crc_table_lazy() builds no tables, but has crc_lazy() build them
+   in tiers as the bytes it has seen accumulate, recorded in tier and seen.
+   table_dbl is allocated by crc_table_dbl() for CRCs longer than a word_t. */
+typedef struct model_s {
     unsigned short width;       /* number of bits in the CRC (the degree of the
                                    polynomial) */
     unsigned short cycle;       /* length of the table_comb[] cycle */
+    unsigned short slices;      /* number of word-wise tables in table_word */
+    unsigned char table_bytes;  /* bytes in each table_word entry */
+    unsigned char table_shift;  /* bits table_word entries are shifted down */
+    unsigned char table_little; /* true if table_word is for little-endian */
+    unsigned char table_bits;   /* word size table_word was built for */
+    unsigned char table_top;    /* shift up of a CRC to its word form */
+    unsigned char table_shared; /* true if table_word is shared */
+    unsigned char tier;         /* tables built so far by crc_lazy() */
     char ref;                   /* if true, reflect input and output */
     char rev;                   /* if true, reverse output */
     word_t poly, poly_hi;       /* polynomial representation (sans x^width) */
@@ -80,15 +117,24 @@ typedef struct {
     word_t check, check_hi;     /* CRC of the nine ASCII bytes "123456789" */
     word_t res, res_hi;         /* Residue of the CRC */
     char *name;                 /* text description of this CRC */
-    word_t table_comb[WORDBITS];        /* table for CRC combination */
-    word_t table_byte[256];             /* table for byte-wise calculation */
-    word_t table_word[WORDCHARS][256];  /* tables for word-wise calculation */
+    word_t table_clmul[9];      /* constants for carry-less multiply */
+    word_t table_hw[2];         /* constants for hardware CRC-32C */
+    crc_func_t *fast[CRC_CLASSES];      /* routines used by crc_fast() */
+    uintmax_t seen;                     /* bytes run through crc_lazy() */
+    word_t *table_byte;                 /* table for byte-wise calculation */
+    void *table_word;                   /* narrow tables for word-wise and
+                                           byte-wise calculation */
+    word_t (*table_braid)[256];         /* tables for braided calculation */
+    word_t *table_comb;                 /* table for CRC combination */
+    word_t (*table_pow)[16];            /* windowed powers for combination */
+    word_t (*table_dbl)[256][2];        /* tables for long CRCs (lo, hi) */
 } model_t;
 
 /* Read and verify a CRC model description from the string str, returning the
    result in *model.  Return 0 on success, 1 on invalid input, or 2 if out of
-   memory.  model->name is allocated and should be freed when done. str is
-   modified in the process, and so it cannot be a literal string.
+   memory.  model->name is allocated and should be freed when done, using
+   free_model().  The table pointers are set to NULL, to be allocated later.
+   str is modified in the process, and so it cannot be a literal string.
 
    The parameters are "width", "poly", "init", "refin", "refout", "xorout",
    "check", "residue", and "name".  The names may be abbreviated to "w", "p",
@@ -137,6 +183,18 @@ typedef struct {
  */
 int read_model(model_t *model, char *str, int lenient);
 
+/* Set the table pointers of model to NULL, and clear the state that goes
+   with the tables: table_shared, the crc_lazy() tier and seen, and the
+   crc_fast() routines in fast[].  Nothing is freed.  This is used by
+   read_model() and free_model(), and by code that makes a model some other
+   way, e.g. crc_map_model() or a copy of a model without its tables. */
+void clear_model(model_t *model);
+
+/* Free the name and the tables allocated for model, and set those pointers to
+   NULL.  Shared tables are left alone.  model can then be used again with
+   read_model(). */
+void free_model(model_t *model);
+
 /* Return the reversal of the low n-bits of x.  1 <= n <= WORDBITS.  The high
    WORDBITS - n bits in x are ignored, and are set to zero in the returned
    result.  A table-driven implementation would be faster, but the speed of